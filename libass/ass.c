@@ -38,6 +38,7 @@
 #include "ass_priv.h"
 #include "ass_shaper.h"
 #include "ass_string.h"
+#include "ass_threading.h"
 
 #define ass_atof(STR) (ass_strtod((STR),NULL))
 
@@ -71,12 +72,6 @@ void ass_free_track(ASS_Track *track)
     if (!track)
         return;
 
-    if (track->parser_priv) {
-        free(track->parser_priv->read_order_bitmap);
-        free(track->parser_priv->fontname);
-        free(track->parser_priv->fontdata);
-        free(track->parser_priv);
-    }
     free(track->style_format);
     free(track->event_format);
     free(track->Language);
@@ -90,6 +85,15 @@ void ass_free_track(ASS_Track *track)
             ass_free_event(track, i);
     }
     free(track->events);
+    if (track->parser_priv) {
+        free(track->parser_priv->read_order_bitmap);
+        free(track->parser_priv->fontname);
+        free(track->parser_priv->fontdata);
+        free(track->parser_priv->event_index);
+        free(track->parser_priv->active_events);
+        free(track->parser_priv->chunk_buf);
+        free(track->parser_priv);
+    }
     free(track->name);
     free(track);
 }
@@ -114,6 +118,8 @@ int ass_alloc_style(ASS_Track *track)
 
     sid = track->n_styles++;
     memset(track->styles + sid, 0, sizeof(ASS_Style));
+    if (track->parser_priv)
+        track->parser_priv->generation++;
     return sid;
 }
 
@@ -144,6 +150,9 @@ void ass_free_event(ASS_Track *track, int eid)
 {
     ASS_Event *event = track->events + eid;
 
+    if (track->parser_priv)
+        track->parser_priv->generation++;
+
     free(event->Name);
     free(event->Effect);
     free(event->Text);
@@ -154,6 +163,8 @@ void ass_free_style(ASS_Track *track, int sid)
 {
     ASS_Style *style = track->styles + sid;
 
+    if (track->parser_priv)
+        track->parser_priv->generation++;
     free(style->Name);
     free(style->FontName);
 }
@@ -554,6 +565,7 @@ void ass_process_force_style(ASS_Track *track)
 
     if (!list)
         return;
+    track->parser_priv->generation++;
 
     for (fs = list; *fs; ++fs) {
         eq = strrchr(*fs, '=');
@@ -1074,55 +1086,102 @@ static void reset_embedded_font_parsing(ASS_ParserPriv *parser_priv)
     parser_priv->fontdata = NULL;
     parser_priv->fontdata_size = 0;
     parser_priv->fontdata_used = 0;
+    parser_priv->fontdata_n_pending = 0;
+}
+
+/**
+ * \brief Make room for extra decoded bytes, growing geometrically.
+ */
+static bool reserve_font_data(ASS_ParserPriv *parser_priv, size_t extra)
+{
+    if (extra > SIZE_MAX - parser_priv->fontdata_used)
+        return false;
+    size_t need = parser_priv->fontdata_used + extra;
+    if (need <= parser_priv->fontdata_size)
+        return true;
+
+    size_t new_size = FFMAX(parser_priv->fontdata_size, 64 * 1024);
+    while (new_size < need)
+        new_size = new_size < SIZE_MAX / 2 ? 2 * new_size : need;
+    if (!ASS_REALLOC_ARRAY(parser_priv->fontdata, new_size))
+        return false;
+    parser_priv->fontdata_size = new_size;
+    return true;
+}
+
+/**
+ * \brief Decode one line of embedded font data, appending to the output.
+ * Groups of 4 characters may span lines.
+ * \return false on allocation failure
+ */
+static bool decode_font_line(ASS_ParserPriv *parser_priv,
+                             const unsigned char *str, size_t len)
+{
+    size_t n_pending = parser_priv->fontdata_n_pending;
+    if (len > SIZE_MAX - n_pending ||
+            !reserve_font_data(parser_priv, (n_pending + len) / 4 * 3))
+        return false;
+
+    unsigned char *pending = parser_priv->fontdata_pending;
+    unsigned char *dst = parser_priv->fontdata + parser_priv->fontdata_used;
+    if (n_pending) {
+        while (n_pending < 4 && len) {
+            pending[n_pending++] = *str++;
+            len--;
+        }
+        if (n_pending == 4) {
+            dst = decode_chars(pending, dst, 4);
+            n_pending = 0;
+        }
+    }
+
+    for (; len >= 4; len -= 4, str += 4)
+        dst = decode_chars(str, dst, 4);
+    while (len--)
+        pending[n_pending++] = *str++;
+
+    parser_priv->fontdata_n_pending = n_pending;
+    parser_priv->fontdata_used = dst - parser_priv->fontdata;
+    return true;
 }
 
 static int decode_font(ASS_Track *track)
 {
-    unsigned char *p;
-    unsigned char *q;
-    size_t i;
-    size_t size;                   // original size
-    size_t dsize;                  // decoded size
-    unsigned char *buf = 0;
-
-    ass_msg(track->library, MSGL_V, "Font: %zu bytes encoded data",
-            track->parser_priv->fontdata_used);
-    size = track->parser_priv->fontdata_used;
-    if (size % 4 == 1) {
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+    size_t n_pending = parser_priv->fontdata_n_pending;
+
+    if (n_pending == 1) {
         ass_msg(track->library, MSGL_ERR, "Bad encoded data size");
         goto error_decode_font;
     }
-    buf = malloc(size / 4 * 3 + FFMAX(size % 4, 1) - 1);
-    if (!buf)
-        goto error_decode_font;
-    q = buf;
-    for (i = 0, p = (unsigned char *) track->parser_priv->fontdata;
-         i < size / 4; i++, p += 4) {
-        q = decode_chars(p, q, 4);
-    }
-    if (size % 4 == 2) {
-        q = decode_chars(p, q, 2);
-    } else if (size % 4 == 3) {
-        q = decode_chars(p, q, 3);
+    if (n_pending) {
+        if (!reserve_font_data(parser_priv, n_pending - 1))
+            goto error_decode_font;
+        unsigned char *dst = parser_priv->fontdata + parser_priv->fontdata_used;
+        dst = decode_chars(parser_priv->fontdata_pending, dst, n_pending);
+        parser_priv->fontdata_used = dst - parser_priv->fontdata;
     }
-    dsize = q - buf;
-    assert(dsize == size / 4 * 3 + FFMAX(size % 4, 1) - 1);
+    ass_msg(track->library, MSGL_V, "Font: %zu bytes decoded data",
+            parser_priv->fontdata_used);
 
-    if (track->library->extract_fonts) {
-        ass_add_font(track->library, track->parser_priv->fontname,
-                     (char *) buf, dsize);
+    if (parser_priv->fontdata_used) {
+        // the buffer is kept for as long as the font is registered
+        unsigned char *buf = realloc(parser_priv->fontdata,
+                                     parser_priv->fontdata_used);
+        if (!buf)
+            buf = parser_priv->fontdata;
+        parser_priv->fontdata = NULL;
+        ass_add_font_ref(track->library, parser_priv->fontname, (char *) buf,
+                         parser_priv->fontdata_used, free, buf);
     }
 
 error_decode_font:
-    free(buf);
-    reset_embedded_font_parsing(track->parser_priv);
+    reset_embedded_font_parsing(parser_priv);
     return 0;
 }
 
 static int process_fonts_line(ASS_Track *track, char *str)
 {
-    size_t len;
-
     if (!strncmp(str, "fontname:", 9)) {
         char *p = str + 9;
         skip_spaces(&p);
@@ -1142,29 +1201,16 @@ static int process_fonts_line(ASS_Track *track, char *str)
         return 1;
     }
 
-    len = strlen(str);
-    if (track->parser_priv->fontdata_used >=
-        SIZE_MAX - FFMAX(len, 100 * 1024)) {
-        goto mem_fail;
-    } else if (track->parser_priv->fontdata_used + len >
-               track->parser_priv->fontdata_size) {
-        size_t new_size =
-                track->parser_priv->fontdata_size + FFMAX(len, 100 * 1024);
-        if (!ASS_REALLOC_ARRAY(track->parser_priv->fontdata, new_size))
-            goto mem_fail;
-        track->parser_priv->fontdata_size = new_size;
-    }
-    if (!track->parser_priv->fontdata)
+    // the data would only be discarded
+    if (!track->library->extract_fonts)
         return 0;
-    memcpy(track->parser_priv->fontdata + track->parser_priv->fontdata_used,
-           str, len);
-    track->parser_priv->fontdata_used += len;
 
+    if (!decode_font_line(track->parser_priv, (unsigned char *) str,
+                          strlen(str))) {
+        reset_embedded_font_parsing(track->parser_priv);
+        return -1;
+    }
     return 0;
-
-mem_fail:
-    reset_embedded_font_parsing(track->parser_priv);
-    return -1;
 }
 
 /**
@@ -1205,6 +1251,12 @@ static int process_line(ASS_Track *track, char *str)
             break;
         }
     }
+
+    // headers and styles may change how existing events are rendered,
+    // while renderers notice new events and fonts on their own
+    if (track->parser_priv->state == PST_INFO ||
+            track->parser_priv->state == PST_STYLES)
+        track->parser_priv->generation++;
     return 0;
 }
 
@@ -1320,12 +1372,18 @@ void ass_process_chunk(ASS_Track *track, const char *data, int size,
 
     if (!track->event_format) {
         ass_msg(track->library, MSGL_WARN, "Event format header missing");
-        goto cleanup;
+        return;
     }
 
-    str = malloc(size + 1);
-    if (!str)
-        goto cleanup;
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+    if ((size_t) size >= parser_priv->chunk_buf_size) {
+        str = realloc(parser_priv->chunk_buf, (size_t) size + 1);
+        if (!str)
+            return;
+        parser_priv->chunk_buf = str;
+        parser_priv->chunk_buf_size = (size_t) size + 1;
+    }
+    str = parser_priv->chunk_buf;
     memcpy(str, data, size);
     str[size] = '\0';
     ass_msg(track->library, MSGL_V, "Event at %" PRId64 ", +%" PRId64 ": %s",
@@ -1333,7 +1391,7 @@ void ass_process_chunk(ASS_Track *track, const char *data, int size,
 
     eid = ass_alloc_event(track);
     if (eid < 0)
-        goto cleanup;
+        return;
     event = track->events + eid;
 
     p = str;
@@ -1353,15 +1411,12 @@ void ass_process_chunk(ASS_Track *track, const char *data, int size,
         event->Start = timecode;
         event->Duration = duration;
         update_prune_ts(track, event->Start + event->Duration);
-        goto cleanup;
+        return;
 //              dump_events(tid);
     } while (0);
     // some error
     ass_free_event(track, eid);
     track->n_events--;
-
-cleanup:
-    free(str);
 }
 
 /**
@@ -1376,40 +1431,87 @@ void ass_flush_events(ASS_Track *track)
             ass_free_event(track, eid);
         track->n_events = 0;
     }
+    // every indexed event is gone, but keep the allocation
+    track->parser_priv->event_index_count = 0;
     free(track->parser_priv->read_order_bitmap);
     track->parser_priv->read_order_bitmap = NULL;
     track->parser_priv->read_order_elems = 0;
 }
 
+void ass_track_invalidate(ASS_Track *track)
+{
+    ASS_ParserPriv *priv = track->parser_priv;
+    priv->event_index_count = 0;
+    priv->generation++;
+
+    // positions of events already on screen may no longer fit
+    for (int i = 0; i < track->n_events; i++) {
+        free(track->events[i].render_priv);
+        track->events[i].render_priv = NULL;
+    }
+}
+
 void ass_configure_prune(ASS_Track *track, long long delay)
 {
     track->parser_priv->prune_delay = delay;
 }
 
+/**
+ * \brief Drop the time index entries of pruned events and renumber the rest.
+ * Kept events stay in the same order, so the index stays sorted.
+ * \param new_eid new number of each indexed event, or -1 if it was freed
+ */
+static void remap_event_index(ASS_ParserPriv *priv, const int *new_eid)
+{
+    EventIndexEntry *index = priv->event_index;
+    long long end_max = LLONG_MIN;
+    int n = 0;
+    for (int i = 0; i < priv->event_index_count; i++) {
+        int eid = new_eid[index[i].event];
+        if (eid < 0)
+            continue;
+        index[n] = index[i];
+        index[n].event = eid;
+        end_max = FFMAX(end_max, index[n].end);
+        index[n].end_max = end_max;
+        n++;
+    }
+    priv->event_index_count = n;
+}
+
 void ass_prune_events(ASS_Track *track, long long deadline)
 {
-    if (deadline < track->parser_priv->prune_next_ts)
+    ASS_ParserPriv *priv = track->parser_priv;
+    if (deadline < priv->prune_next_ts)
         return;
 
-    const bool check_readorder = track->parser_priv->check_readorder;
+    const bool check_readorder = priv->check_readorder;
     const int old_n_events = track->n_events;
+    const int n_indexed = priv->event_index_count;
 
     int n_kept = 0;
     ASS_Event *events = track->events;
+    // if this fails, the index is simply rebuilt on the next lookup
+    int *new_eid = n_indexed ? ass_realloc_array(NULL, n_indexed, sizeof(int)) : NULL;
 
-    track->parser_priv->prune_next_ts = LLONG_MAX;
+    priv->prune_next_ts = LLONG_MAX;
     for (int k = 0; k < old_n_events;) {
         // discardable sequence
         for (; k < old_n_events && events[k].Start + events[k].Duration < deadline; k++) {
             if (check_readorder)
                 clear_read_order_bit(track, events[k].ReadOrder);
             ass_free_event(track, k);
+            if (new_eid && k < n_indexed)
+                new_eid[k] = -1;
         }
 
         // to-be-kept sequence
         int move_from = k;
-        for (long long ts; k < old_n_events && (ts = events[k].Start + events[k].Duration) >= deadline; k++)
+        for (long long ts; k < old_n_events && (ts = events[k].Start + events[k].Duration) >= deadline; k++) {
             update_prune_ts(track, ts);
+            if (new_eid && k < n_indexed)
+                new_eid[k] = n_kept + k - move_from;
+        }
 
         // Relocate kept events
         if (move_from < k) {
@@ -1419,6 +1521,220 @@ void ass_prune_events(ASS_Track *track, long long deadline)
         }
     }
     track->n_events = n_kept;
+
+    if (new_eid)
+        remap_event_index(priv, new_eid);
+    else
+        priv->event_index_count = 0;
+    free(new_eid);
+}
+
+static int cmp_event_index(const void *a, const void *b)
+{
+    const EventIndexEntry *ea = a, *eb = b;
+    if (ea->start != eb->start)
+        return ea->start < eb->start ? -1 : 1;
+    return ea->event - eb->event;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+static inline void fill_event_index(ASS_Track *track, EventIndexEntry *entry,
+                                    int eid)
+{
+    ASS_Event *event = track->events + eid;
+    entry->start = event->Start;
+    entry->end = event->Start + event->Duration;
+    entry->event = eid;
+}
+
+/**
+ * \brief Bring the time index up to date with track->events.
+ * Events appended since the last update are sorted separately and merged
+ * into the existing index, so streaming one event at a time stays cheap.
+ * Entries are only created here and not in ass_alloc_event,
+ * since event times are filled in after allocation.
+ */
+static bool update_event_index(ASS_Track *track)
+{
+    ASS_ParserPriv *priv = track->parser_priv;
+    int old_count = priv->event_index_count;
+    int count = track->n_events;
+    if (old_count > count)
+        old_count = 0;
+    if (old_count == count)
+        return true;
+
+    if (count > priv->event_index_max) {
+        int new_max = FFMAX(track->max_events, count);
+        if (!ASS_REALLOC_ARRAY(priv->event_index, new_max))
+            return false;
+        priv->event_index_max = new_max;
+    }
+
+    EventIndexEntry *index = priv->event_index;
+    int first_changed = 0;
+    if (!old_count) {
+        for (int i = 0; i < count; i++)
+            fill_event_index(track, index + i, i);
+        qsort(index, count, sizeof(EventIndexEntry), cmp_event_index);
+    } else {
+        int n_new = count - old_count;
+        EventIndexEntry *added = ass_realloc_array(NULL, n_new, sizeof(EventIndexEntry));
+        if (!added)
+            return false;
+        for (int i = 0; i < n_new; i++)
+            fill_event_index(track, added + i, old_count + i);
+        qsort(added, n_new, sizeof(EventIndexEntry), cmp_event_index);
+
+        // merge from the back, leaving the unaffected head in place
+        int i = old_count - 1, j = n_new - 1, k = count - 1;
+        while (j >= 0) {
+            if (i >= 0 && cmp_event_index(index + i, added + j) > 0)
+                index[k--] = index[i--];
+            else
+                index[k--] = added[j--];
+        }
+        first_changed = k + 1;
+        free(added);
+    }
+
+    long long end_max = first_changed ? index[first_changed - 1].end_max : LLONG_MIN;
+    for (int i = first_changed; i < count; i++) {
+        end_max = FFMAX(end_max, index[i].end);
+        index[i].end_max = end_max;
+    }
+    priv->event_index_count = count;
+    return true;
+}
+
+static bool add_active_event(ASS_ParserPriv *priv, int *n, int eid)
+{
+    if (*n >= priv->active_events_max) {
+        int new_max = 2 * priv->active_events_max + 16;
+        if (!ASS_REALLOC_ARRAY(priv->active_events, new_max))
+            return false;
+        priv->active_events_max = new_max;
+    }
+    priv->active_events[(*n)++] = eid;
+    return true;
+}
+
+static inline bool event_index_entry_valid(ASS_Track *track,
+                                           const EventIndexEntry *entry)
+{
+    ASS_Event *event = track->events + entry->event;
+    return entry->start == event->Start &&
+           entry->end == event->Start + event->Duration;
+}
+
+/**
+ * \brief Look up the events displayed at the given time in the time index.
+ * Every visited entry is checked against its event, to catch events
+ * whose times were changed in place since they were indexed.
+ * \param cursor see ass_advance_active_events(), may be NULL
+ * \return number of active events, or -1 on allocation failure
+ * or if a stale entry was found
+ */
+static int find_indexed_events(ASS_Track *track, long long now,
+                               size_t *cursor)
+{
+    ASS_ParserPriv *priv = track->parser_priv;
+    int n = 0;
+
+    if (!update_event_index(track))
+        return -1;
+
+    // find the first event starting after now
+    const EventIndexEntry *index = priv->event_index;
+    size_t lo = 0, hi = priv->event_index_count;
+    if (cursor && *cursor <= hi && (!*cursor || index[*cursor - 1].start <= now)) {
+        // moving forward in time: advance from the previous position
+        lo = *cursor;
+        while (lo < hi && index[lo].start <= now)
+            lo++;
+    } else {
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (index[mid].start <= now)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+    }
+    if (cursor)
+        *cursor = lo;
+    if (lo < priv->event_index_count && !event_index_entry_valid(track, index + lo))
+        return -1;
+
+    // walk back until no earlier event can still be displayed
+    for (size_t i = lo; i > 0 && index[i - 1].end_max > now; i--) {
+        if (!event_index_entry_valid(track, index + i - 1))
+            return -1;
+        if (now < index[i - 1].end && !add_active_event(priv, &n, index[i - 1].event))
+            break;
+    }
+    return n;
+}
+
+static int find_active_events(ASS_Track *track, long long now,
+                              size_t *cursor, int **events)
+{
+    ASS_ParserPriv *priv = track->parser_priv;
+
+    int n = find_indexed_events(track, now, cursor);
+    if (n < 0) {
+        // rebuild the whole index, in case an event was edited in place
+        priv->event_index_count = 0;
+        n = find_indexed_events(track, now, cursor);
+    }
+    if (n < 0) {
+        // out of memory, fall back to a full scan
+        priv->event_index_count = 0;
+        n = 0;
+        for (int i = 0; i < track->n_events; i++) {
+            ASS_Event *event = track->events + i;
+            if (event->Start <= now && now < event->Start + event->Duration &&
+                    !add_active_event(priv, &n, i))
+                break;
+        }
+    }
+
+    // keep the same order as a linear scan of track->events
+    if (n > 1)
+        qsort(priv->active_events, n, sizeof(int), cmp_int);
+    *events = priv->active_events;
+    return n;
+}
+
+/**
+ * \brief Find events displayed at the given time.
+ * \param track track
+ * \param now timestamp in milliseconds
+ * \param events receives the ids of the active events in ascending order,
+ * the array is owned by the track and valid until the next call
+ * \return number of active events
+ */
+int ass_find_active_events(ASS_Track *track, long long now, int **events)
+{
+    return find_active_events(track, now, NULL, events);
+}
+
+/**
+ * \brief Find events displayed at the given time, continuing the index
+ * search from the previous call with the same cursor. For ascending
+ * timestamps, the index is then traversed once instead of searched anew
+ * for every call. Other timestamps fall back to a full search.
+ * \param cursor position in the time index, initialize to 0
+ * \see ass_find_active_events()
+ */
+int ass_advance_active_events(ASS_Track *track, long long now,
+                              size_t *cursor, int **events)
+{
+    return find_active_events(track, now, cursor, events);
 }
 
 #ifdef CONFIG_ICONV
@@ -1789,6 +2105,9 @@ ASS_Track *ass_new_track(ASS_Library *library)
     track->parser_priv->check_readorder = 1;
     track->parser_priv->prune_delay = -1;
     track->parser_priv->prune_next_ts = LLONG_MAX;
+
+    static size_t last_track_id;
+    track->parser_priv->track_id = ass_atomic_inc(&last_track_id);
     return track;
 
 fail:
@@ -1834,6 +2153,7 @@ int ass_track_set_feature(ASS_Track *track, ASS_Feature feature, int enable)
         track->parser_priv->feature_flags |= requested;
     else
         track->parser_priv->feature_flags &= ~requested;
+    track->parser_priv->generation++;
 
     return 0;
 }
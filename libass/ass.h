@@ -24,7 +24,7 @@
 #include <stdarg.h>
 #include "ass_types.h"
 
-#define LIBASS_VERSION 0x01705000
+#define LIBASS_VERSION 0x01705010
 
 #ifdef __cplusplus
 extern "C" {
@@ -106,6 +106,62 @@ typedef enum {
     ASS_HINTING_NATIVE
 } ASS_Hinting;
 
+/**
+ * Caches of a renderer, see ass_renderer_get_cache_stats().
+ */
+typedef enum {
+    ASS_CACHE_FONT = 0,
+    ASS_CACHE_OUTLINE,
+    ASS_CACHE_BITMAP,
+    ASS_CACHE_COMPOSITE,
+    ASS_CACHE_FACE_SIZE_METRICS,
+    ASS_CACHE_GLYPH_METRICS,
+    ASS_CACHE_LAYOUT,           // shaped and wrapped text of events
+} ASS_CacheType;
+
+/*
+ * Usage statistics of a cache.
+ * Sizes are measured in the units of the corresponding limit: bytes for
+ * the bitmap and composite caches, which share the bitmap limit of
+ * ass_set_cache_limits(), and items for all other caches.
+ */
+typedef struct ass_cache_stats {
+    uint64_t hits;          // lookups answered from the cache
+    uint64_t misses;        // lookups that had to construct a new value
+    uint64_t construct_ns;  // total time spent constructing values, in ns
+    uint64_t evictions;     // items dropped to stay within the cache limit
+    uint64_t evicted_size;  // total size of evicted items
+    uint64_t items;         // items currently in the cache
+    uint64_t size;          // current total size
+} ASS_CacheStats;
+
+/*
+ * Time spent in the stages of rendering a frame, in nanoseconds,
+ * see ass_get_frame_timings(). Stage times are summed over all rendering
+ * threads, so with ass_set_threads() they can add up to more than total.
+ * Each stage includes the cache lookups for its results; time spent in
+ * stages that are not listed is only part of total.
+ */
+typedef struct ass_frame_timings {
+    int64_t total;          // the whole ass_render_frame() call
+    int64_t parse;          // override tag parsing and font selection
+    int64_t shape;          // text shaping
+    int64_t wrap;           // line wrapping
+    int64_t outline;        // glyph and drawing outline construction
+    int64_t stroke;         // border outline construction
+    int64_t raster;         // outline rasterization
+    int64_t composite;      // combining glyph bitmaps, blur and shadows
+    int64_t render_text;    // building the image list
+} ASS_FrameTimings;
+
+/*
+ * Area of the frame in pixels, [x_min, x_max) x [y_min, y_max),
+ * see ass_get_damage().
+ */
+typedef struct ass_damage_rect {
+    int x_min, y_min, x_max, y_max;
+} ASS_DamageRect;
+
 /**
  * \brief Text shaping levels.
  *
@@ -317,6 +373,22 @@ void ass_library_done(ASS_Library *priv);
  */
 void ass_set_fonts_dir(ASS_Library *priv, const char *fonts_dir);
 
+/**
+ * \brief Set the file of the system font index.
+ * Enumerating the fonts of the system, which happens whenever a renderer
+ * sets up its fonts, can take a long time on systems with many fonts.
+ * If an index file is set, the fontconfig font provider loads the list
+ * of system fonts from it instead, as long as none of the font directories
+ * and fontconfig configuration files changed since it was written.
+ * Otherwise the fonts are enumerated as usual and the index is (re)written.
+ * The file can be shared by multiple processes.
+ * Other font providers currently ignore this setting.
+ *
+ * \param priv library handle
+ * \param filename index file path, or NULL to disable (default)
+ */
+void ass_set_font_index(ASS_Library *priv, const char *filename);
+
 /**
  * \brief Whether fonts should be extracted from track data.
  * \param priv library handle
@@ -606,6 +678,126 @@ int ass_fonts_update(ASS_Renderer *priv);
 void ass_set_cache_limits(ASS_Renderer *priv, int glyph_max,
                           int bitmap_max_size);
 
+/**
+ * \brief Set the limit of the bitmap memory pool.
+ * Released glyph, border and composite bitmaps, blur temporaries and
+ * the buffers of freed images are kept in a pool of the renderer for
+ * reuse, up to this total size. The pool is separate from the bitmap
+ * cache and its limit.
+ *
+ * \param priv renderer handle
+ * \param max_size maximum size of kept buffers (in MB), zero for
+ * a reasonable default or negative to disable pooling
+ */
+void ass_set_bitmap_pool_limit(ASS_Renderer *priv, int max_size);
+
+/**
+ * \brief Get usage statistics of one of the renderer's caches.
+ * Counters accumulate over the lifetime of the cache. The font, outline and
+ * metrics caches are shared with the other renderers of the cache group
+ * (see ass_set_cache_group()), so their statistics include all of them.
+ * \param priv renderer handle
+ * \param cache cache to query
+ * \param stats out: statistics
+ * \return 1 on success, 0 if cache is not a valid ASS_CacheType
+ */
+int ass_renderer_get_cache_stats(ASS_Renderer *priv, ASS_CacheType cache,
+                                 ASS_CacheStats *stats);
+
+/**
+ * \brief Enable or disable per-stage timing of ass_render_frame().
+ * Timing is disabled by default; enabling it adds a little overhead
+ * to every rendered glyph.
+ * \param priv renderer handle
+ * \param enable 1 to enable, 0 to disable
+ */
+void ass_set_frame_timing(ASS_Renderer *priv, int enable);
+
+/**
+ * \brief Get the stage timings of the last ass_render_frame() call.
+ * \param priv renderer handle
+ * \param timings out: timings; all zero if no frame was rendered
+ * with timing enabled yet
+ * \return 1 on success, 0 if timing is disabled
+ */
+int ass_get_frame_timings(ASS_Renderer *priv, ASS_FrameTimings *timings);
+
+/**
+ * \brief Enable or disable merging of image fragments.
+ * When enabled, consecutive images from events of the same layer that
+ * have the same color and touch without overlapping, such as the parts of
+ * a glyph split by inverse clips or karaoke, are returned as one image.
+ * Blending the list gives the same result with fewer images. Merged images
+ * get new bitmaps with every rendered frame, so detect_change reports them
+ * as changed unless the whole previous frame is returned again.
+ * Merging is disabled by default.
+ * \param priv renderer handle
+ * \param enable 1 to enable, 0 to disable
+ */
+void ass_set_image_merging(ASS_Renderer *priv, int enable);
+
+/**
+ * \brief Set the number of threads used for rendering.
+ * Events displayed at the same time are rendered in parallel, and
+ * large outlines of a single event, such as full-frame drawings and
+ * vector clips, are rasterized in horizontal bands on all threads;
+ * the resulting image list is identical to single-threaded rendering.
+ * Text shaping and glyph loading are still serialized between threads.
+ * \param priv renderer handle
+ * \param threads number of threads, including the thread calling
+ * ass_render_frame(); values <= 1 disable multithreading (the default)
+ * \return number of threads that will actually be used, which is 1 if
+ * libass was built without thread support or thread creation failed
+ * NOTE: With more than one thread, the message callback set by
+ * ass_set_message_cb() may be invoked from worker threads while
+ * ass_render_frame() is running.
+ */
+int ass_set_threads(ASS_Renderer *priv, int threads);
+
+/**
+ * \brief Create a cache group that can be shared by several renderers.
+ * Renderers attached to the same group share loaded fonts, glyph outlines
+ * and glyph metrics, which only depend on the fonts and not on the frame
+ * geometry, so e.g. renderers producing several resolutions of the same
+ * subtitles do not load and decompose the same glyphs repeatedly.
+ * Every renderer starts out with a private group of its own.
+ *
+ * The font configuration lives in the group as well: ass_set_fonts(),
+ * ass_create_font_provider() and the glyph limit of ass_set_cache_limits()
+ * apply to all renderers of the group, whichever renderer they are called on.
+ * Calling ass_set_fonts() with the configuration the group already uses
+ * keeps the loaded fonts and cached glyphs, so it can be called on every
+ * renderer of the group.
+ *
+ * Renderers of one group can render frames concurrently from different
+ * threads if libass was built with thread support. ass_set_fonts() and
+ * ass_set_cache_group() must not be called while any renderer
+ * of the group is rendering.
+ * \param library library handle; all renderers of the group must use it
+ * \return group handle or NULL on failure
+ */
+ASS_CacheGroup *ass_cache_group_init(ASS_Library *library);
+
+/**
+ * \brief Release the group handle returned by ass_cache_group_init().
+ * The group stays alive until all renderers attached to it are finalized
+ * or moved to another group.
+ * \param group group handle or NULL
+ */
+void ass_cache_group_done(ASS_CacheGroup *group);
+
+/**
+ * \brief Attach a renderer to a cache group, leaving its previous group.
+ * The images returned by the last ass_render_frame() call on this renderer
+ * become invalid. Fonts have to be configured with ass_set_fonts() on one
+ * of the group's renderers before rendering.
+ * \param priv renderer handle
+ * \param group group handle
+ * \return 1 on success, 0 if the group was created for a different library
+ * or on allocation failure; the renderer stays in its previous group then
+ */
+int ass_set_cache_group(ASS_Renderer *priv, ASS_CacheGroup *group);
+
 /**
  * \brief Render a frame, producing a list of ASS_Image.
  * \param priv renderer handle
@@ -613,10 +805,135 @@ void ass_set_cache_limits(ASS_Renderer *priv, int glyph_max,
  * \param now video timestamp in milliseconds
  * \param detect_change compare to the previous call and set to 1
  * if positions may have changed, or set to 2 if content may have changed.
+ * If the previous frame contains no animations and neither the displayed
+ * events nor the settings have changed, the previous image list is returned
+ * again as is and detect_change is set to 0. Changes made through the API
+ * are detected; after modifying track, event or style fields directly,
+ * ass_track_invalidate() must be called to force a new frame.
  */
 ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
                             long long now, int *detect_change);
 
+/**
+ * \brief Get the areas of the frame that changed with the last
+ * ass_render_frame() call. Blending the new images over a clear frame
+ * differs from blending the previous ones only inside these rectangles,
+ * which do not overlap. They are only computed if detect_change was passed
+ * to the call; otherwise, or if the previous image list is unknown, a single
+ * rectangle covering the whole frame is reported. An unchanged frame
+ * (detect_change set to 0) has no rectangles.
+ * \param priv renderer handle
+ * \param rects out: the rectangles, valid until the next rendering call
+ * \return number of rectangles
+ */
+int ass_get_damage(ASS_Renderer *priv, const ASS_DamageRect **rects);
+
+/**
+ * \brief Render a frame and composite it into a single RGBA image.
+ * The buffer receives the same output as blending all images returned by
+ * ass_render_frame() in order onto a transparent frame. Pixels are
+ * premultiplied by alpha and stored with byte order R, G, B, A; alpha 255
+ * is opaque. Compositing is spread over the threads set with
+ * ass_set_threads().
+ * \param priv renderer handle
+ * \param track subtitle track
+ * \param now video timestamp in milliseconds
+ * \param buf frame buffer of the size set with ass_set_frame_size(),
+ * completely overwritten
+ * \param stride distance between rows of buf in bytes, at least 4 * width
+ * \param detect_change as with ass_render_frame()
+ * \return 1 on success, 0 if no frame size is set or stride is too small
+ */
+int ass_render_frame_rgba(ASS_Renderer *priv, ASS_Track *track,
+                          long long now, uint8_t *buf, int stride,
+                          int *detect_change);
+
+/*
+ * Chroma layouts of ASS_YUVFrame.
+ */
+typedef enum {
+    ASS_YUV_PLANAR = 0,     // separate U and V planes, e.g. YUV420P
+    ASS_YUV_SEMI_PLANAR,    // one plane of interleaved U and V, e.g. NV12
+} ASS_YUVLayout;
+
+/*
+ * Video frame for ass_render_frame_yuv(). Samples with a bit depth above 8
+ * are stored in native-endian 16-bit words, in their low bits (YUV420P10)
+ * or, with msb_aligned set, in their high bits (P010).
+ */
+typedef struct ass_yuv_frame {
+    uint8_t *planes[3];     // Y, U, V; or Y, interleaved UV
+    int strides[3];         // distance between rows in bytes
+    ASS_YUVLayout layout;
+    int bit_depth;          // 8 to 16
+    int msb_aligned;
+    int chroma_shift_x;     // log2 of the horizontal chroma subsampling, 0 to 2
+    int chroma_shift_y;     // log2 of the vertical chroma subsampling, 0 to 2
+    // colorspace of the video, one of the values from YCBCR_BT601_TV on
+    ASS_YCbCrMatrix matrix;
+} ASS_YUVFrame;
+
+/**
+ * \brief Render a frame and blend it directly into YCbCr video.
+ * Subtitle colors are converted to YCbCr as described for
+ * ASS_YCbCrMatrix: with the matrix of the track's "YCbCr Matrix" header,
+ * TV-range BT.601 if it is missing, or the video's matrix if it is "None".
+ * Chroma is blended with the coverage averaged over each chroma sample.
+ * Blending is spread over the threads set with ass_set_threads().
+ * \param priv renderer handle
+ * \param track subtitle track
+ * \param now video timestamp in milliseconds
+ * \param frame video frame of the size set with ass_set_frame_size()
+ * \param detect_change as with ass_render_frame()
+ * \return 1 on success, 0 if no frame size is set, frame is not supported
+ * or on allocation failure
+ */
+int ass_render_frame_yuv(ASS_Renderer *priv, ASS_Track *track,
+                         long long now, const ASS_YUVFrame *frame,
+                         int *detect_change);
+
+/**
+ * \brief Render a sequence of frames in one call.
+ * The output is the same as from calling ass_render_frame() for each
+ * timestamp in turn, except that the caller receives its own reference to
+ * every image list, so that all of them stay valid until released with
+ * ass_release_frame(). Frames that are unchanged from their predecessor
+ * (see ass_render_frame()) are returned as the same list.
+ * Frames are processed in batches: each batch is set up and trims the caches
+ * once, and the events of all its frames are rendered together by the
+ * threads set with ass_set_threads(). For ascending timestamps, the active
+ * events are found in a single pass over the track. Events are pruned
+ * (see ass_configure_prune()) after each batch. ass_get_damage() refers
+ * to the last frame and ass_get_frame_timings() to the last batch.
+ * \param priv renderer handle
+ * \param track subtitle track
+ * \param times n video timestamps in milliseconds
+ * \param n number of frames
+ * \param images out: n image lists
+ * \param detect_change out: n change flags as with ass_render_frame(),
+ * each compared to the preceding frame; may be NULL
+ */
+void ass_render_frames(ASS_Renderer *priv, ASS_Track *track,
+                       const long long *times, int n,
+                       ASS_Image **images, int *detect_change);
+
+/**
+ * \brief Render the frames at start, start + step, ...,
+ * start + (n - 1) * step, see ass_render_frames().
+ */
+void ass_render_frame_range(ASS_Renderer *priv, ASS_Track *track,
+                            long long start, long long step, int n,
+                            ASS_Image **images, int *detect_change);
+
+/**
+ * \brief Release an image list returned by ass_render_frames()
+ * or ass_render_frame_range(). All lists of a renderer must be released
+ * before ass_renderer_done() is called on it, from the thread that uses
+ * the renderer.
+ * \param img image list, may be NULL
+ */
+void ass_release_frame(ASS_Image *img);
+
 
 /*
  * The following functions operate on track objects and do not need
@@ -765,6 +1082,19 @@ void ass_configure_prune(ASS_Track *track, long long delay);
 */
 void ass_flush_events(ASS_Track *track);
 
+/**
+ * \brief Notify libass of direct changes to the track.
+ * Needs to be called after modifying fields of the track or of its existing
+ * events or styles in place (see the GENERAL NOTE in ass_types.h), before
+ * the track is rendered again. Renderers do not return their previous frame
+ * again (see ass_render_frame()), the lookup of events by time is rebuilt,
+ * and so are the positions of events chosen to avoid collisions.
+ * Appending events with ass_alloc_event() or the parsing functions
+ * does not require this.
+ * \param track track
+ */
+void ass_track_invalidate(ASS_Track *track);
+
 /**
  * \brief Read subtitles from file.
  * \param library library handle
@@ -813,6 +1143,25 @@ int ass_read_styles(ASS_Track *track, const char *fname, const char *codepage);
 void ass_add_font(ASS_Library *library, const char *name, const char *data,
                   int data_size);
 
+/**
+ * \brief Add a memory font without copying its data.
+ * Embedded fonts are only parsed as far as needed to match them by name,
+ * so registering large fonts by reference keeps their memory untouched
+ * until a script actually uses them.
+ * \param library library handle
+ * \param name attachment name
+ * \param data binary font data, e.g. a memory-mapped file; it must stay
+ * valid and unchanged until release is called
+ * \param data_size data size
+ * \param release called with opaque once libass no longer needs data,
+ * which happens in ass_clear_fonts, in ass_library_done or right away if the
+ * font could not be added; can be NULL
+ * \param opaque user data passed to release
+ */
+void ass_add_font_ref(ASS_Library *library, const char *name,
+                      const char *data, size_t data_size,
+                      void (*release)(void *opaque), void *opaque);
+
 /**
  * \brief Remove all fonts stored in an ass_library object.
  * This can only be called safely if all ASS_Track and ASS_Renderer instances
@@ -65,7 +65,7 @@ static void be_blur_post(uint8_t *buf, intptr_t stride, intptr_t width, intptr_t
     }
 }
 
-void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
+void ass_synth_blur(const BitmapEngine *engine, ASS_ThreadPool *pool, Bitmap *bm,
                     int be, double blur_r2x, double blur_r2y)
 {
     if (!bm->buffer)
@@ -73,7 +73,7 @@ void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
 
     // Apply gaussian blur
     if (blur_r2x > 0.001 || blur_r2y > 0.001)
-        ass_gaussian_blur(engine, bm, blur_r2x, blur_r2y);
+        ass_gaussian_blur(engine, pool, bm, blur_r2x, blur_r2y);
 
     if (!be)
         return;
@@ -81,7 +81,7 @@ void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
     // Apply box blur (multiple passes, if requested)
     unsigned align = 1 << engine->align_order;
     size_t size = sizeof(uint16_t) * bm->stride * 2;
-    uint16_t *tmp = ass_aligned_alloc(align, size, false);
+    uint16_t *tmp = ass_bitmap_pool_get(engine->pool, align, &size, false);
     if (!tmp)
         return;
 
@@ -97,7 +97,7 @@ void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
         be_blur_post(buf, stride, w, h);
     }
     engine->be_blur(buf, stride, w, h, tmp);
-    ass_aligned_free(tmp);
+    ass_bitmap_pool_put(engine->pool, tmp, size);
 }
 
 bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm,
@@ -108,28 +108,31 @@ bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm,
     // Too often we use ints as offset for bitmaps => use INT_MAX.
     if (s > (INT_MAX - align) / FFMAX(h, 1))
         return false;
-    uint8_t *buf = ass_aligned_alloc(align, s * h + align, zero);
+    size_t size = s * h + align;
+    uint8_t *buf = ass_bitmap_pool_get(engine->pool, align, &size, zero);
     if (!buf)
         return false;
     bm->w = w;
     bm->h = h;
     bm->stride = s;
     bm->buffer = buf;
+    bm->size = size;
+    bm->pool = engine->pool;
     return true;
 }
 
 bool ass_realloc_bitmap(const BitmapEngine *engine, Bitmap *bm, int32_t w, int32_t h)
 {
-    uint8_t *old = bm->buffer;
+    Bitmap old = *bm;
     if (!ass_alloc_bitmap(engine, bm, w, h, false))
         return false;
-    ass_aligned_free(old);
+    ass_free_bitmap(&old);
     return true;
 }
 
 void ass_free_bitmap(Bitmap *bm)
 {
-    ass_aligned_free(bm->buffer);
+    ass_bitmap_pool_put(bm->pool, bm->buffer, bm->size);
 }
 
 bool ass_copy_bitmap(const BitmapEngine *engine, Bitmap *dst, const Bitmap *src)
@@ -146,6 +149,34 @@ bool ass_copy_bitmap(const BitmapEngine *engine, Bitmap *dst, const Bitmap *src)
     return true;
 }
 
+// outlines covering at least this many pixels are rasterized in bands
+// on all threads, smaller ones are not worth the splitting overhead
+#define PARALLEL_FILL_MIN_AREA (512 * 512)
+
+static bool rasterizer_fill(RenderContext *state, Bitmap *bm, int x0, int y0)
+{
+    ASS_Renderer *render_priv = state->renderer;
+    RasterizerData *rst = &state->rasterizer;
+
+    // Worker threads only rasterize inside of jobs, when the pool is busy,
+    // so only the main context can hand work to them, and only while
+    // it is not rendering events in parallel itself.
+    if (state != &render_priv->state ||
+            (int64_t) bm->w * bm->h < PARALLEL_FILL_MIN_AREA ||
+            !ass_thread_pool_available(render_priv->thread_pool))
+        return ass_rasterizer_fill(&render_priv->engine, rst, bm->buffer,
+                                   x0, y0, bm->stride, bm->h, bm->stride);
+
+    int n_threads = ass_thread_pool_size(render_priv->thread_pool);
+    RasterizerData *scratch[ASS_MAX_THREADS];
+    scratch[0] = &render_priv->band_rasterizer;
+    for (int i = 1; i < n_threads; i++)
+        scratch[i] = &render_priv->worker_states[i - 1].rasterizer;
+    return ass_rasterizer_fill_bands(&render_priv->engine, rst,
+                                     scratch, render_priv->thread_pool,
+                                     bm->buffer, x0, y0, bm->stride, bm->h, bm->stride);
+}
+
 bool ass_outline_to_bitmap(RenderContext *state, Bitmap *bm,
                            ASS_Outline *outline1, ASS_Outline *outline2)
 {
@@ -186,8 +217,7 @@ bool ass_outline_to_bitmap(RenderContext *state, Bitmap *bm,
     bm->left = x_min;
     bm->top  = y_min;
 
-    if (!ass_rasterizer_fill(&render_priv->engine, rst, bm->buffer,
-                             x_min, y_min, bm->stride, tile_h, bm->stride)) {
+    if (!rasterizer_fill(state, bm, x_min, y_min)) {
         ass_msg(render_priv->library, MSGL_WARN, "Failed to rasterize glyph!\n");
         ass_free_bitmap(bm);
         return false;
@@ -26,12 +26,16 @@
 #include "ass.h"
 #include "ass_outline.h"
 #include "ass_bitmap_engine.h"
+#include "ass_bitmap_pool.h"
+#include "ass_threading.h"
 
 typedef struct {
     int32_t left, top;
     int32_t w, h;         // width, height
     ptrdiff_t stride;
     uint8_t *buffer;      // h * stride buffer
+    size_t size;          // allocated size of buffer
+    BitmapPool *pool;     // pool to return buffer to
 } Bitmap;
 
 bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm, int32_t w, int32_t h, bool zero);
@@ -44,10 +48,11 @@ struct render_context;
 bool ass_outline_to_bitmap(struct render_context *state, Bitmap *bm,
                            ASS_Outline *outline1, ASS_Outline *outline2);
 
-void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
+void ass_synth_blur(const BitmapEngine *engine, ASS_ThreadPool *pool, Bitmap *bm,
                     int be, double blur_r2x, double blur_r2y);
 
-bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, double r2y);
+bool ass_gaussian_blur(const BitmapEngine *engine, ASS_ThreadPool *pool,
+                       Bitmap *bm, double r2x, double r2y);
 void ass_shift_bitmap(Bitmap *bm, int shift_x, int shift_y);
 void ass_fix_outline(Bitmap *bm_g, Bitmap *bm_o);
 
@@ -164,8 +164,17 @@ BitmapEngine ass_bitmap_engine_init(unsigned mask)
 {
     ALL_PROTOTYPES(16, c)
     BLUR_PROTOTYPES(32, c)
+    BlendRGBAFunc ass_blend_rgba_c;
+    BlendYUVFunc ass_blend_plane8_c, ass_blend_uv8_c;
+    BlendYUVFunc ass_blend_plane16_c, ass_blend_uv16_c;
     BitmapEngine engine = {0};
     engine.tile_order = mask & ASS_FLAG_LARGE_TILES ? 5 : 4;
+    // frame compositing functions have no asm versions
+    engine.blend_rgba = ass_blend_rgba_c;
+    engine.blend_plane8 = ass_blend_plane8_c;
+    engine.blend_uv8 = ass_blend_uv8_c;
+    engine.blend_plane16 = ass_blend_plane16_c;
+    engine.blend_uv16 = ass_blend_uv16_c;
 
 #if CONFIG_ASM
     unsigned flags = ass_get_cpu_flags(mask);
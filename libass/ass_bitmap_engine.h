@@ -29,6 +29,9 @@
  * - All strides must be multiples of the engine alignment
  * - All buffers, except for BitmapBlendFunc and sources of BitmapMulFunc,
  *   must be aligned to the engine alignment
+ * - BlendRGBAFunc and BlendYUVFunc take ASS_Image bitmaps and frame
+ *   buffers, so both their sources and destinations can have any
+ *   alignment and stride
  */
 
 struct segment;
@@ -48,6 +51,20 @@ typedef void BitmapMulFunc(uint8_t *restrict dst, ptrdiff_t dst_stride,
                            const uint8_t *restrict src2, ptrdiff_t src2_stride,
                            size_t width, size_t height);
 
+// blend a monochrome bitmap in the ASS_Image color 0xRRGGBBAA
+// onto premultiplied RGBA pixels with byte order R, G, B, A
+typedef void BlendRGBAFunc(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                           const uint8_t *restrict src, ptrdiff_t src_stride,
+                           size_t width, size_t height, uint32_t color);
+
+// blend a monochrome bitmap with opacity alpha onto video samples;
+// value is the sample value, or U | V << 16 for interleaved chroma.
+// 16-bit samples hold the value in bits [shift, shift + depth).
+typedef void BlendYUVFunc(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                          const uint8_t *restrict src, ptrdiff_t src_stride,
+                          size_t width, size_t height,
+                          uint32_t value, unsigned alpha, unsigned shift);
+
 typedef void BeBlurFunc(uint8_t *restrict buf, ptrdiff_t stride,
                         size_t width, size_t height, uint16_t *restrict tmp);
 
@@ -62,9 +79,15 @@ typedef void ParamFilterFunc(int16_t *restrict dst, const int16_t *restrict src,
                              size_t src_width, size_t src_height,
                              const int16_t *restrict param);
 
+struct bitmap_pool;
+
 typedef struct {
     int align_order;  // log2(alignment)
 
+    // buffers of bitmaps and blur temporaries are taken from this pool
+    // if it is set, which is left to the owner of the engine
+    struct bitmap_pool *pool;
+
     // rasterizer functions
     int tile_order;  // log2(tile_size)
     FillSolidTileFunc *fill_solid;
@@ -76,6 +99,11 @@ typedef struct {
     BitmapBlendFunc *add_bitmaps, *imul_bitmaps;
     BitmapMulFunc *mul_bitmaps;
 
+    // frame compositing functions
+    BlendRGBAFunc *blend_rgba;
+    BlendYUVFunc *blend_plane8, *blend_uv8;    // 8-bit samples
+    BlendYUVFunc *blend_plane16, *blend_uv16;  // 16-bit samples
+
     // be blur function
     BeBlurFunc *be_blur;
 
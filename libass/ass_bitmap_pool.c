@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_utils.h"
+#include "ass_threading.h"
+#include "ass_bitmap_pool.h"
+
+#define MIN_ORDER 6     // log2 of the smallest class size
+#define MAX_ORDER 26    // larger buffers are not kept
+// classes 2^(order-1) * (4 + k) / 4 with k = 1..4, after the smallest one
+#define N_CLASSES (4 * (MAX_ORDER - MIN_ORDER) + 1)
+
+struct bitmap_pool {
+    ASS_Mutex lock;
+    unsigned align;
+    size_t max_size;
+    size_t free_size;               // total size of kept buffers
+    void *free[N_CLASSES];          // linked through their first bytes
+};
+
+/**
+ * \brief Find the size class of a buffer.
+ * \param size in: required size, out: size of the class
+ * \return class index, or -1 if such buffers are not pooled
+ */
+static int size_class(size_t *size)
+{
+    if (*size <= (size_t) 1 << MIN_ORDER) {
+        *size = (size_t) 1 << MIN_ORDER;
+        return 0;
+    }
+    int order = MIN_ORDER + 1;
+    while (((size_t) 1 << order) < *size)
+        if (++order > MAX_ORDER)
+            return -1;
+    size_t step = (size_t) 1 << (order - 3);
+    size_t k = (*size + step - 1) / step - 4;
+    *size = (4 + k) * step;
+    return 4 * (order - MIN_ORDER - 1) + k;
+}
+
+static size_t class_size(int index)
+{
+    if (!index)
+        return (size_t) 1 << MIN_ORDER;
+    int order = MIN_ORDER + 1 + (index - 1) / 4;
+    return (size_t) (4 + (index - 1) % 4 + 1) << (order - 3);
+}
+
+BitmapPool *ass_bitmap_pool_create(unsigned align, size_t max_size)
+{
+    BitmapPool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+    if (!ass_mutex_init(&pool->lock, false)) {
+        free(pool);
+        return NULL;
+    }
+    pool->align = align;
+    pool->max_size = max_size;
+    return pool;
+}
+
+// called with lock held
+static void trim(BitmapPool *pool)
+{
+    for (int i = N_CLASSES - 1; i >= 0 && pool->free_size > pool->max_size; i--) {
+        while (pool->free[i] && pool->free_size > pool->max_size) {
+            void *buf = pool->free[i];
+            pool->free[i] = *(void **) buf;
+            pool->free_size -= class_size(i);
+            ass_aligned_free(buf);
+        }
+    }
+}
+
+void ass_bitmap_pool_free(BitmapPool *pool)
+{
+    if (!pool)
+        return;
+    pool->max_size = 0;
+    trim(pool);
+    ass_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void ass_bitmap_pool_set_limit(BitmapPool *pool, size_t max_size)
+{
+    if (!pool)
+        return;
+    ass_mutex_lock(&pool->lock);
+    pool->max_size = max_size;
+    trim(pool);
+    ass_mutex_unlock(&pool->lock);
+}
+
+void *ass_bitmap_pool_get(BitmapPool *pool, unsigned align, size_t *size, bool zero)
+{
+    if (!pool)
+        return ass_aligned_alloc(align, *size, zero);
+    assert(align <= pool->align);
+
+    int index = size_class(size);
+    if (index < 0)
+        return ass_aligned_alloc(pool->align, *size, zero);
+
+    ass_mutex_lock(&pool->lock);
+    void *buf = pool->free[index];
+    if (buf) {
+        pool->free[index] = *(void **) buf;
+        pool->free_size -= *size;
+    }
+    ass_mutex_unlock(&pool->lock);
+
+    if (!buf)
+        return ass_aligned_alloc(pool->align, *size, zero);
+    if (zero)
+        memset(buf, 0, *size);
+    return buf;
+}
+
+void ass_bitmap_pool_put(BitmapPool *pool, void *buf, size_t size)
+{
+    if (!buf)
+        return;
+    int index = pool ? size_class(&size) : -1;
+    if (index < 0) {
+        ass_aligned_free(buf);
+        return;
+    }
+
+    ass_mutex_lock(&pool->lock);
+    if (pool->free_size + size > pool->max_size) {
+        ass_mutex_unlock(&pool->lock);
+        ass_aligned_free(buf);
+        return;
+    }
+    *(void **) buf = pool->free[index];
+    pool->free[index] = buf;
+    pool->free_size += size;
+    ass_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_BITMAP_POOL_H
+#define LIBASS_BITMAP_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Thread-safe pool of aligned buffers for bitmaps and their temporaries.
+ * Sizes are rounded up to one of four classes per octave, and released
+ * buffers are kept for reuse as long as their total size stays under
+ * the limit of the pool. A NULL pool allocates and frees directly.
+ */
+typedef struct bitmap_pool BitmapPool;
+
+BitmapPool *ass_bitmap_pool_create(unsigned align, size_t max_size);
+void ass_bitmap_pool_free(BitmapPool *pool);
+
+/**
+ * \brief Change the maximal total size of kept buffers,
+ * releasing the excess right away.
+ */
+void ass_bitmap_pool_set_limit(BitmapPool *pool, size_t max_size);
+
+/**
+ * \brief Get an aligned buffer.
+ * \param align alignment, not larger than that of the pool
+ * \param size in: required size, out: allocated size to pass back on release
+ * \param zero whether to clear the whole allocated size
+ */
+void *ass_bitmap_pool_get(BitmapPool *pool, unsigned align, size_t *size, bool zero);
+void ass_bitmap_pool_put(BitmapPool *pool, void *buf, size_t size);
+
+#endif /* LIBASS_BITMAP_POOL_H */
@@ -165,12 +165,273 @@ static void find_best_method(BlurMethod *blur, double r2)
         blur->coeff[i] = (int) (0x10000 * mu[i] + 0.5);
 }
 
+/**
+ * \brief Run the blur passes over the unpacked image in buf[0]
+ * \param width, height in: source size, out: size of the result
+ * \return index of the buffer holding the result
+ */
+static int blur_serial(const BitmapEngine *engine, int16_t *buf[2],
+                       uint32_t *width, uint32_t *height,
+                       const BlurMethod *blur_x, const BlurMethod *blur_y)
+{
+    uint32_t w = *width, h = *height;
+    int index = 0;
+
+    for (int i = 0; i < blur_y->level; i++) {
+        engine->shrink_vert(buf[index ^ 1], buf[index], w, h);
+        h = (h + 5) >> 1;
+        index ^= 1;
+    }
+    for (int i = 0; i < blur_x->level; i++) {
+        engine->shrink_horz(buf[index ^ 1], buf[index], w, h);
+        w = (w + 5) >> 1;
+        index ^= 1;
+    }
+    assert(blur_x->radius >= 4 && blur_x->radius <= 8);
+    engine->blur_horz[blur_x->radius - 4](buf[index ^ 1], buf[index], w, h, blur_x->coeff);
+    w += 2 * blur_x->radius;
+    index ^= 1;
+    assert(blur_y->radius >= 4 && blur_y->radius <= 8);
+    engine->blur_vert[blur_y->radius - 4](buf[index ^ 1], buf[index], w, h, blur_y->coeff);
+    h += 2 * blur_y->radius;
+    index ^= 1;
+    for (int i = 0; i < blur_x->level; i++) {
+        engine->expand_horz(buf[index ^ 1], buf[index], w, h);
+        w = 2 * w + 4;
+        index ^= 1;
+    }
+    for (int i = 0; i < blur_y->level; i++) {
+        engine->expand_vert(buf[index ^ 1], buf[index], w, h);
+        h = 2 * h + 4;
+        index ^= 1;
+    }
+    *width = w;
+    *height = h;
+    return index;
+}
+
+
+/*
+ * Parallel Blur
+ *
+ * Columns of the stripe layout are independent in vertical passes,
+ * so these are split into groups of whole stripes. Rows are independent
+ * in horizontal passes, but the stripe layout interleaves them,
+ * so each job gathers a band of rows into a compact buffer of its own,
+ * runs the consecutive horizontal passes there and scatters the result back.
+ */
+
+// bitmaps of at least this many pixels are blurred on all threads
+#define BLUR_PARALLEL_MIN_AREA (256 * 256)
+#define BLUR_JOBS_PER_THREAD 4
+#define BLUR_MAX_JOBS (BLUR_JOBS_PER_THREAD * ASS_MAX_THREADS)
+
+typedef struct {
+    const BitmapEngine *engine;
+    const BlurMethod *blur_x;
+    const uint8_t *bitmap;      // source of stripe_unpack
+    ptrdiff_t bitmap_stride;
+    int16_t *dst;
+    const int16_t *src;
+    uint32_t w, h;              // source size
+    uint32_t dst_h;             // destination height of vertical passes
+    FilterFunc *filter;
+    ParamFilterFunc *param_filter;
+    const int16_t *param;
+    bool expand;                // expand rather than shrink and blur rows
+    uint32_t band_w;            // largest width of intermediate rows
+    int stripes, band_height;   // work of a single job
+    bool ok[BLUR_MAX_JOBS];
+} BlurJobs;
+
+static void unpack_job(void *priv, int job, int thread)
+{
+    BlurJobs *jobs = priv;
+    size_t stripe_width = (size_t) 1 << (jobs->engine->align_order - 1);
+    size_t x = job * jobs->stripes * stripe_width;
+    size_t w = FFMIN(jobs->stripes * stripe_width, jobs->w - x);
+    jobs->engine->stripe_unpack(jobs->dst + x * jobs->h, jobs->bitmap + x,
+                                jobs->bitmap_stride, w, jobs->h);
+}
+
+static void vert_job(void *priv, int job, int thread)
+{
+    BlurJobs *jobs = priv;
+    size_t stripe_width = (size_t) 1 << (jobs->engine->align_order - 1);
+    size_t x = job * jobs->stripes * stripe_width;
+    size_t w = FFMIN(jobs->stripes * stripe_width, jobs->w - x);
+    int16_t *dst = jobs->dst + x * jobs->dst_h;
+    const int16_t *src = jobs->src + x * jobs->h;
+    if (jobs->param_filter)
+        jobs->param_filter(dst, src, w, jobs->h, jobs->param);
+    else
+        jobs->filter(dst, src, w, jobs->h);
+}
+
+static void horz_job(void *priv, int job, int thread)
+{
+    BlurJobs *jobs = priv;
+    const BitmapEngine *engine = jobs->engine;
+    size_t stripe_width = (size_t) 1 << (engine->align_order - 1);
+    size_t y = (size_t) job * jobs->band_height;
+    size_t h = FFMIN(jobs->band_height, jobs->h - y);
+
+    size_t band_size = ass_align(stripe_width, jobs->band_w) * h;
+    size_t size = 2 * band_size * sizeof(int16_t);
+    int16_t *tmp = ass_bitmap_pool_get(engine->pool, 2 * stripe_width, &size, false);
+    jobs->ok[job] = tmp;
+    if (!tmp)
+        return;
+    int16_t *buf[2] = { tmp, tmp + band_size };
+    int index = 0;
+
+    uint32_t w = jobs->w;
+    size_t line_size = stripe_width * h * sizeof(int16_t);
+    for (size_t x = 0; x < w; x += stripe_width)
+        memcpy(buf[0] + x * h, jobs->src + x * jobs->h + y * stripe_width, line_size);
+
+    const BlurMethod *blur = jobs->blur_x;
+    if (jobs->expand) {
+        for (int i = 0; i < blur->level; i++) {
+            engine->expand_horz(buf[index ^ 1], buf[index], w, h);
+            w = 2 * w + 4;
+            index ^= 1;
+        }
+    } else {
+        for (int i = 0; i < blur->level; i++) {
+            engine->shrink_horz(buf[index ^ 1], buf[index], w, h);
+            w = (w + 5) >> 1;
+            index ^= 1;
+        }
+        engine->blur_horz[blur->radius - 4](buf[index ^ 1], buf[index], w, h, blur->coeff);
+        w += 2 * blur->radius;
+        index ^= 1;
+    }
+
+    for (size_t x = 0; x < w; x += stripe_width)
+        memcpy(jobs->dst + x * jobs->h + y * stripe_width, buf[index] + x * h, line_size);
+    ass_bitmap_pool_put(engine->pool, tmp, size);
+}
+
+static void run_stripe_jobs(ASS_ThreadPool *pool, ASS_ThreadJobFunc func,
+                            BlurJobs *jobs, int max_jobs)
+{
+    int stripe_width = 1 << (jobs->engine->align_order - 1);
+    int n_stripes = (jobs->w + stripe_width - 1) / stripe_width;
+    // keep the 8-bit source of stripe_unpack aligned
+    jobs->stripes = ((n_stripes + 2 * max_jobs - 1) / max_jobs) & ~1;
+    ass_thread_pool_run(pool, func, jobs, (n_stripes + jobs->stripes - 1) / jobs->stripes);
+}
+
+static bool run_band_jobs(ASS_ThreadPool *pool, BlurJobs *jobs, int max_jobs)
+{
+    jobs->band_height = (jobs->h + max_jobs - 1) / max_jobs;
+    int n_jobs = (jobs->h + jobs->band_height - 1) / jobs->band_height;
+    ass_thread_pool_run(pool, horz_job, jobs, n_jobs);
+    for (int i = 0; i < n_jobs; i++)
+        if (!jobs->ok[i])
+            return false;
+    return true;
+}
+
+/**
+ * \brief Unpack and blur like stripe_unpack() followed by blur_serial(),
+ * with the passes split into jobs of the thread pool
+ * \param width, height out: size of the result
+ * \return index of the buffer holding the result, or -1 on error
+ */
+static int blur_parallel(const BitmapEngine *engine, ASS_ThreadPool *pool,
+                         int16_t *buf[2], const Bitmap *bm,
+                         uint32_t *width, uint32_t *height,
+                         const BlurMethod *blur_x, const BlurMethod *blur_y)
+{
+    BlurJobs jobs = {
+        .engine = engine,
+        .blur_x = blur_x,
+        .bitmap = bm->buffer,
+        .bitmap_stride = bm->stride,
+    };
+    int max_jobs = BLUR_JOBS_PER_THREAD * ass_thread_pool_size(pool);
+    uint32_t w = bm->w, h = bm->h;
+    int index = 0;
+
+    jobs.dst = buf[0];
+    jobs.w = w;
+    jobs.h = h;
+    run_stripe_jobs(pool, unpack_job, &jobs, max_jobs);
+
+    jobs.filter = engine->shrink_vert;
+    for (int i = 0; i < blur_y->level; i++) {
+        jobs.src = buf[index];
+        jobs.dst = buf[index ^ 1];
+        jobs.h = h;
+        jobs.dst_h = (h + 5) >> 1;
+        run_stripe_jobs(pool, vert_job, &jobs, max_jobs);
+        h = jobs.dst_h;
+        index ^= 1;
+    }
+
+    jobs.src = buf[index];
+    jobs.dst = buf[index ^ 1];
+    jobs.h = h;
+    jobs.band_w = w;
+    for (int i = 0; i < blur_x->level; i++)
+        w = (w + 5) >> 1;
+    w += 2 * blur_x->radius;
+    jobs.band_w = FFMAX(jobs.band_w, w);
+    if (!run_band_jobs(pool, &jobs, max_jobs))
+        return -1;
+    index ^= 1;
+
+    jobs.src = buf[index];
+    jobs.dst = buf[index ^ 1];
+    jobs.w = w;
+    jobs.dst_h = h + 2 * blur_y->radius;
+    jobs.filter = NULL;
+    jobs.param_filter = engine->blur_vert[blur_y->radius - 4];
+    jobs.param = blur_y->coeff;
+    run_stripe_jobs(pool, vert_job, &jobs, max_jobs);
+    h = jobs.dst_h;
+    index ^= 1;
+
+    if (blur_x->level) {
+        jobs.src = buf[index];
+        jobs.dst = buf[index ^ 1];
+        jobs.h = h;
+        jobs.expand = true;
+        for (int i = 0; i < blur_x->level; i++)
+            w = 2 * w + 4;
+        jobs.band_w = w;
+        if (!run_band_jobs(pool, &jobs, max_jobs))
+            return -1;
+        index ^= 1;
+    }
+
+    jobs.param_filter = NULL;
+    jobs.filter = engine->expand_vert;
+    for (int i = 0; i < blur_y->level; i++) {
+        jobs.src = buf[index];
+        jobs.dst = buf[index ^ 1];
+        jobs.w = w;
+        jobs.h = h;
+        jobs.dst_h = 2 * h + 4;
+        run_stripe_jobs(pool, vert_job, &jobs, max_jobs);
+        h = jobs.dst_h;
+        index ^= 1;
+    }
+    *width = w;
+    *height = h;
+    return index;
+}
+
 /**
  * \brief Perform approximate gaussian blur
+ * \param pool thread pool to spread the work of large bitmaps over, can be NULL
  * \param r2x in: desired standard deviation along X axis squared
  * \param r2y in: desired standard deviation along Y axis squared
  */
-bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, double r2y)
+bool ass_gaussian_blur(const BitmapEngine *engine, ASS_ThreadPool *pool,
+                       Bitmap *bm, double r2x, double r2y)
 {
     BlurMethod blur_x, blur_y;
     find_best_method(&blur_x, r2x);
@@ -189,53 +450,29 @@ bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, doubl
     if (size > INT_MAX / 4)
         return false;
 
-    int16_t *tmp = ass_aligned_alloc(2 * stripe_width, 4 * size, false);
+    size_t tmp_size = 4 * size;
+    int16_t *tmp = ass_bitmap_pool_get(engine->pool, 2 * stripe_width, &tmp_size, false);
     if (!tmp)
         return false;
 
-    engine->stripe_unpack(tmp, bm->buffer, bm->stride, w, h);
     int16_t *buf[2] = {tmp, tmp + size};
-    int index = 0;
-
-    for (int i = 0; i < blur_y.level; i++) {
-        engine->shrink_vert(buf[index ^ 1], buf[index], w, h);
-        h = (h + 5) >> 1;
-        index ^= 1;
-    }
-    for (int i = 0; i < blur_x.level; i++) {
-        engine->shrink_horz(buf[index ^ 1], buf[index], w, h);
-        w = (w + 5) >> 1;
-        index ^= 1;
-    }
-    assert(blur_x.radius >= 4 && blur_x.radius <= 8);
-    engine->blur_horz[blur_x.radius - 4](buf[index ^ 1], buf[index], w, h, blur_x.coeff);
-    w += 2 * blur_x.radius;
-    index ^= 1;
-    assert(blur_y.radius >= 4 && blur_y.radius <= 8);
-    engine->blur_vert[blur_y.radius - 4](buf[index ^ 1], buf[index], w, h, blur_y.coeff);
-    h += 2 * blur_y.radius;
-    index ^= 1;
-    for (int i = 0; i < blur_x.level; i++) {
-        engine->expand_horz(buf[index ^ 1], buf[index], w, h);
-        w = 2 * w + 4;
-        index ^= 1;
-    }
-    for (int i = 0; i < blur_y.level; i++) {
-        engine->expand_vert(buf[index ^ 1], buf[index], w, h);
-        h = 2 * h + 4;
-        index ^= 1;
+    int index;
+    if ((uint64_t) w * h >= BLUR_PARALLEL_MIN_AREA && ass_thread_pool_available(pool)) {
+        index = blur_parallel(engine, pool, buf, bm, &w, &h, &blur_x, &blur_y);
+    } else {
+        engine->stripe_unpack(tmp, bm->buffer, bm->stride, w, h);
+        index = blur_serial(engine, buf, &w, &h, &blur_x, &blur_y);
     }
-    assert(w == end_w && h == end_h);
+    assert(index < 0 || (w == end_w && h == end_h));
 
-    if (!ass_realloc_bitmap(engine, bm, w, h)) {
-        ass_aligned_free(tmp);
+    if (index < 0 || !ass_realloc_bitmap(engine, bm, w, h)) {
+        ass_bitmap_pool_put(engine->pool, tmp, tmp_size);
         return false;
     }
     bm->left -= ((blur_x.radius + 4) << blur_x.level) - 4;
     bm->top  -= ((blur_y.radius + 4) << blur_y.level) - 4;
 
     engine->stripe_pack(bm->buffer, bm->stride, buf[index], w, h);
-    ass_aligned_free(tmp);
+    ass_bitmap_pool_put(engine->pool, tmp, tmp_size);
     return true;
 }
-
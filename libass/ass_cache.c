@@ -29,6 +29,7 @@
 #include "ass_font.h"
 #include "ass_outline.h"
 #include "ass_cache.h"
+#include "ass_threading.h"
 
 // Always enable native-endian mode, since we don't care about cross-platform consistency of the hash
 #define WYHASH_LITTLE_ENDIAN 1
@@ -137,16 +138,19 @@ static bool composite_compare(void *a, void *b)
 static bool composite_key_move(void *dst, void *src)
 {
     CompositeHashKey *d = dst, *s = src;
-    if (d) {
-        *d = *s;
-        for (size_t i = 0; i < d->bitmap_count; i++) {
-            ass_cache_inc_ref(d->bitmaps[i].bm);
-            ass_cache_inc_ref(d->bitmaps[i].bm_o);
-        }
+    if (!d)
         return true;
-    }
 
-    free(s->bitmaps);
+    // the source array is scratch memory of the render context
+    *d = *s;
+    d->bitmaps = ass_realloc_array(NULL, s->bitmap_count, sizeof(BitmapRef));
+    if (!d->bitmaps)
+        return false;
+    memcpy(d->bitmaps, s->bitmaps, s->bitmap_count * sizeof(BitmapRef));
+    for (size_t i = 0; i < d->bitmap_count; i++) {
+        ass_cache_inc_ref(d->bitmaps[i].bm);
+        ass_cache_inc_ref(d->bitmaps[i].bm_o);
+    }
     return true;
 }
 
@@ -325,24 +329,104 @@ const CacheDesc glyph_metrics_cache_desc = {
 };
 
 
+// layout cache
+static bool layout_key_move(void *dst, void *src)
+{
+    LayoutHashKey *d = dst, *s = src;
+    if (!d)
+        return true;
+
+    *d = *s;
+    d->glyphs.str = ass_copy_string(s->glyphs);
+    d->drawings.str = ass_copy_string(s->drawings);
+    d->language.str = ass_copy_string(s->language);
+    if (d->glyphs.str && d->drawings.str && d->language.str)
+        return true;
+    free((char *) d->glyphs.str);
+    free((char *) d->drawings.str);
+    free((char *) d->language.str);
+    return false;
+}
+
+static void layout_destruct(void *key, void *value)
+{
+    LayoutHashValue *v = value;
+    LayoutHashKey *k = key;
+    for (size_t i = 0; i < v->n_outlines; i++)
+        ass_cache_dec_ref(v->outlines[i]);
+    free(v->outlines);
+    free(v->glyphs);
+    free(v->lines);
+    free((char *) k->glyphs.str);
+    free((char *) k->drawings.str);
+    free((char *) k->language.str);
+}
+
+size_t ass_layout_construct(void *key, void *value, void *priv);
+
+const CacheDesc layout_cache_desc = {
+    .hash_func = layout_hash,
+    .compare_func = layout_compare,
+    .key_move_func = layout_key_move,
+    .construct_func = ass_layout_construct,
+    .destruct_func = layout_destruct,
+    .key_size = sizeof(LayoutHashKey),
+    .value_size = sizeof(LayoutHashValue)
+};
+
 
 // Cache data
+typedef struct cache_shard CacheShard;
+
 typedef struct cache_item {
-    Cache *cache;
+    CacheShard *shard;  // set on creation, never changes
     const CacheDesc *desc;
     struct cache_item *next, **prev;
     struct cache_item *queue_next, **queue_prev;
-    size_t size, ref_count;
+    ass_hashcode hash;
+    size_t size;        // zero size means the value is still being constructed
+    size_t ref_count;   // only accessed atomically
+    // nonzero once the item has been removed from its cache by emptying it;
+    // set under the shard lock, read atomically
+    size_t detached;
 } CacheItem;
 
-struct cache {
-    unsigned buckets;
+// The cache is split into independently locked shards, selected by
+// the top bits of the hash, so that concurrent lookups rarely contend.
+// Each shard keeps its own LRU queue and size accounting,
+// the size limit applies to the sum of all shards.
+#define CACHE_SHARD_BITS 4
+#define CACHE_SHARDS (1 << CACHE_SHARD_BITS)
+
+// Hash tables are allocated on first insertion and double in size
+// whenever the number of items exceeds the number of buckets.
+// Items are moved to the larger table incrementally,
+// a few buckets per access, to avoid latency spikes.
+#define CACHE_MIN_BUCKETS 16
+#define CACHE_REHASH_STEP 4
+
+struct cache_shard {
+    size_t buckets;         // power of two, zero if map is not allocated
     CacheItem **map;
+    size_t old_buckets;     // previous table, still being rehashed
+    CacheItem **old_map;
+    size_t rehash_pos;      // buckets of old_map below it are empty
+    size_t n_items;
+    size_t n_constructing;  // items whose value is not ready yet
     CacheItem *queue_first, **queue_last;
 
-    const CacheDesc *desc;
-
     size_t cache_size;
+    ASS_CacheStats stats;   // counters only, items and size are filled on query
+
+    // protects all of the above
+    ASS_Mutex lock;
+    // signaled when a value finishes construction
+    ASS_Cond construct_done;
+};
+
+struct cache {
+    const CacheDesc *desc;
+    CacheShard shards[CACHE_SHARDS];
 };
 
 #define CACHE_ALIGN 8
@@ -358,6 +442,132 @@ static inline CacheItem *value_to_item(void *value)
     return (CacheItem *) ((char *) value - CACHE_ITEM_SIZE);
 }
 
+static inline size_t item_cost(CacheItem *item)
+{
+    return item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+}
+
+
+static bool shard_init(CacheShard *shard)
+{
+    shard->queue_last = &shard->queue_first;
+    if (!ass_mutex_init(&shard->lock, false))
+        return false;
+    if (!ass_cond_init(&shard->construct_done)) {
+        ass_mutex_destroy(&shard->lock);
+        return false;
+    }
+    return true;
+}
+
+static void shard_done(CacheShard *shard)
+{
+    ass_cond_destroy(&shard->construct_done);
+    ass_mutex_destroy(&shard->lock);
+    free(shard->old_map);
+    free(shard->map);
+}
+
+static inline void link_item(CacheItem **bucketptr, CacheItem *item)
+{
+    if (*bucketptr)
+        (*bucketptr)->prev = &item->next;
+    item->prev = bucketptr;
+    item->next = *bucketptr;
+    *bucketptr = item;
+}
+
+static inline void unlink_item(CacheShard *shard, CacheItem *item)
+{
+    if (item->next)
+        item->next->prev = item->prev;
+    *item->prev = item->next;
+    shard->n_items--;
+}
+
+// Move up to n buckets of the old table into the current one
+static void rehash_step(CacheShard *shard, size_t n)
+{
+    if (!shard->old_map)
+        return;
+
+    size_t end = shard->old_buckets;
+    if (n < end - shard->rehash_pos)
+        end = shard->rehash_pos + n;
+    for (size_t i = shard->rehash_pos; i < end; i++) {
+        CacheItem *item = shard->old_map[i];
+        while (item) {
+            CacheItem *next = item->next;
+            link_item(&shard->map[item->hash & (shard->buckets - 1)], item);
+            item = next;
+        }
+    }
+    shard->rehash_pos = end;
+    if (end < shard->old_buckets)
+        return;
+
+    free(shard->old_map);
+    shard->old_map = NULL;
+    shard->old_buckets = 0;
+}
+
+// Make room for one more item; fails only if there is no table at all
+static bool shard_reserve(CacheShard *shard)
+{
+    if (shard->n_items < shard->buckets)
+        return true;
+
+    size_t buckets = shard->buckets ? 2 * shard->buckets : CACHE_MIN_BUCKETS;
+    CacheItem **map = calloc(buckets, sizeof(CacheItem *));
+    if (!map)
+        return shard->map != NULL;  // keep going with longer chains
+
+    // normally a no-op: rehashing finishes long before the table fills up
+    rehash_step(shard, SIZE_MAX);
+    shard->old_map = shard->map;
+    shard->old_buckets = shard->buckets;
+    shard->rehash_pos = 0;
+    shard->map = map;
+    shard->buckets = buckets;
+    return true;
+}
+
+static CacheItem *find_in_chain(CacheItem *item, const CacheDesc *desc,
+                                void *key, ass_hashcode hash)
+{
+    size_t key_offs = CACHE_ITEM_SIZE + align_cache(desc->value_size);
+    for (; item; item = item->next)
+        if (item->hash == hash &&
+                desc->compare_func(key, (char *) item + key_offs))
+            return item;
+    return NULL;
+}
+
+static CacheItem *find_item(CacheShard *shard, const CacheDesc *desc,
+                            void *key, ass_hashcode hash)
+{
+    if (shard->old_map) {
+        size_t bucket = hash & (shard->old_buckets - 1);
+        if (bucket >= shard->rehash_pos) {
+            CacheItem *item = find_in_chain(shard->old_map[bucket],
+                                            desc, key, hash);
+            if (item)
+                return item;
+        }
+    }
+    if (!shard->map)
+        return NULL;
+    return find_in_chain(shard->map[hash & (shard->buckets - 1)],
+                         desc, key, hash);
+}
+
+static inline void destroy_item(const CacheDesc *desc, CacheItem *item)
+{
+    assert(item->desc == desc);
+    char *value = (char *) item + CACHE_ITEM_SIZE;
+    desc->destruct_func(value + align_cache(desc->value_size), value);
+    free(item);
+}
 
 // Create a cache with type-specific hash/compare/destruct/size functions
 Cache *ass_cache_create(const CacheDesc *desc)
@@ -365,11 +575,12 @@ Cache *ass_cache_create(const CacheDesc *desc)
     Cache *cache = calloc(1, sizeof(*cache));
     if (!cache)
         return NULL;
-    cache->buckets = 0xFFFF;
-    cache->queue_last = &cache->queue_first;
     cache->desc = desc;
-    cache->map = calloc(cache->buckets, sizeof(CacheItem *));
-    if (!cache->map) {
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        if (shard_init(&cache->shards[i]))
+            continue;
+        while (i--)
+            shard_done(&cache->shards[i]);
         free(cache);
         return NULL;
     }
@@ -381,63 +592,100 @@ Cache *ass_cache_create(const CacheDesc *desc)
 // creating one if it does not already exist.
 // The returned item is guaranteed to be valid until the next ass_cache_cut call;
 // to extend its lifetime further, call ass_cache_inc_ref().
+// Safe to call from multiple threads; values are constructed without
+// holding any lock, concurrent requests for the same key wait
+// for the first one to finish construction.
 void *ass_cache_get(Cache *cache, void *key, void *priv)
 {
     const CacheDesc *desc = cache->desc;
     size_t key_offs = CACHE_ITEM_SIZE + align_cache(desc->value_size);
-    unsigned bucket = desc->hash_func(key, ASS_HASH_INIT) % cache->buckets;
-    CacheItem *item = cache->map[bucket];
-    while (item) {
-        if (desc->compare_func(key, (char *) item + key_offs)) {
-            assert(item->size);
-            if (!item->queue_prev || item->queue_next) {
-                if (item->queue_prev) {
-                    item->queue_next->queue_prev = item->queue_prev;
-                    *item->queue_prev = item->queue_next;
-                } else
-                    item->ref_count++;
-                *cache->queue_last = item;
-                item->queue_prev = cache->queue_last;
-                cache->queue_last = &item->queue_next;
-                item->queue_next = NULL;
+    ass_hashcode hash = desc->hash_func(key, ASS_HASH_INIT);
+    CacheShard *shard = &cache->shards[hash >> (64 - CACHE_SHARD_BITS)];
+retry:
+    ass_mutex_lock(&shard->lock);
+    rehash_step(shard, CACHE_REHASH_STEP);
+    CacheItem *item = find_item(shard, desc, key, hash);
+    if (item) {
+        // The value is being constructed by another thread. Keep a reference
+        // while waiting, so that the item cannot be cut or emptied away.
+        bool waited = !item->size;
+        if (waited) {
+            ass_atomic_inc(&item->ref_count);
+            while (!item->size)
+                ass_cond_wait(&shard->construct_done, &shard->lock);
+            if (item->detached) {
+                ass_mutex_unlock(&shard->lock);
+                if (!ass_atomic_dec(&item->ref_count))
+                    destroy_item(desc, item);
+                goto retry;
             }
-            desc->key_move_func(NULL, key);
+        }
 
-            return (char *) item + CACHE_ITEM_SIZE;
+        shard->stats.hits++;
+        if (!item->queue_prev || item->queue_next) {
+            if (item->queue_prev) {
+                item->queue_next->queue_prev = item->queue_prev;
+                *item->queue_prev = item->queue_next;
+            } else if (waited)
+                waited = false;  // the queue takes over our reference
+            else
+                ass_atomic_inc(&item->ref_count);
+            *shard->queue_last = item;
+            item->queue_prev = shard->queue_last;
+            shard->queue_last = &item->queue_next;
+            item->queue_next = NULL;
         }
-        item = item->next;
+        if (waited)
+            ass_atomic_dec(&item->ref_count);  // never the last, queued
+        ass_mutex_unlock(&shard->lock);
+        desc->key_move_func(NULL, key);
+
+        return (char *) item + CACHE_ITEM_SIZE;
     }
 
-    item = malloc(key_offs + desc->key_size);
+    item = shard_reserve(shard) ? malloc(key_offs + desc->key_size) : NULL;
     if (!item) {
+        ass_mutex_unlock(&shard->lock);
         desc->key_move_func(NULL, key);
         return NULL;
     }
-    item->cache = cache;
+    item->shard = shard;
     item->desc = desc;
+    item->detached = 0;
     void *new_key = (char *) item + key_offs;
     if (!desc->key_move_func(new_key, key)) {
+        ass_mutex_unlock(&shard->lock);
         free(item);
         return NULL;
     }
-    void *value = (char *) item + CACHE_ITEM_SIZE;
-    item->size = desc->construct_func(new_key, value, priv);
-    assert(item->size);
+    item->hash = hash;
+    item->size = 0;
+    shard->n_constructing++;
+    shard->stats.misses++;
 
-    CacheItem **bucketptr = &cache->map[bucket];
-    if (*bucketptr)
-        (*bucketptr)->prev = &item->next;
-    item->prev = bucketptr;
-    item->next = *bucketptr;
-    *bucketptr = item;
+    link_item(&shard->map[hash & (shard->buckets - 1)], item);
+    shard->n_items++;
 
-    *cache->queue_last = item;
-    item->queue_prev = cache->queue_last;
-    cache->queue_last = &item->queue_next;
+    *shard->queue_last = item;
+    item->queue_prev = shard->queue_last;
+    shard->queue_last = &item->queue_next;
     item->queue_next = NULL;
     item->ref_count = 1;
+    ass_mutex_unlock(&shard->lock);
 
-    cache->cache_size += item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+    void *value = (char *) item + CACHE_ITEM_SIZE;
+    int64_t start = ass_time_ns();
+    size_t size = desc->construct_func(new_key, value, priv);
+    int64_t duration = ass_time_ns() - start;
+    assert(size);
+
+    ass_mutex_lock(&shard->lock);
+    item->size = size;
+    shard->n_constructing--;
+    shard->cache_size += item_cost(item);
+    shard->stats.construct_ns += duration;
+    ass_cond_broadcast(&shard->construct_done);
+    ass_mutex_unlock(&shard->lock);
     return value;
 }
 
@@ -447,12 +695,16 @@ void *ass_cache_key(void *value)
     return (char *) value + align_cache(item->desc->value_size);
 }
 
-static inline void destroy_item(const CacheDesc *desc, CacheItem *item)
+// Destroy a list of items linked through queue_next.
+// Must be called without holding any shard lock, since destructors
+// release references to other items, possibly of the same cache.
+static void destroy_item_list(const CacheDesc *desc, CacheItem *item)
 {
-    assert(item->desc == desc);
-    char *value = (char *) item + CACHE_ITEM_SIZE;
-    desc->destruct_func(value + align_cache(desc->value_size), value);
-    free(item);
+    while (item) {
+        CacheItem *next = item->queue_next;
+        destroy_item(desc, item);
+        item = next;
+    }
 }
 
 void ass_cache_inc_ref(void *value)
@@ -460,8 +712,8 @@ void ass_cache_inc_ref(void *value)
     if (!value)
         return;
     CacheItem *item = value_to_item(value);
-    assert(item->size && item->ref_count);
-    item->ref_count++;
+    assert(item->size && ass_atomic_load(&item->ref_count));
+    ass_atomic_inc(&item->ref_count);
 }
 
 void ass_cache_dec_ref(void *value)
@@ -469,78 +721,223 @@ void ass_cache_dec_ref(void *value)
     if (!value)
         return;
     CacheItem *item = value_to_item(value);
-    assert(item->size && item->ref_count);
-    if (--item->ref_count)
-        return;
+    assert(item->size);
 
-    Cache *cache = item->cache;
-    if (cache) {
-        if (item->next)
-            item->next->prev = item->prev;
-        *item->prev = item->next;
+    // Fast path: not the last reference, so the item stays alive
+    // and no cache structure needs to be touched.
+    size_t ref_count = ass_atomic_load(&item->ref_count);
+    assert(ref_count);
+    while (ref_count > 1)
+        if (ass_atomic_cas(&item->ref_count, &ref_count, ref_count - 1))
+            return;
+
+    // Possibly the last reference: decrement under the lock,
+    // so that a concurrent lookup cannot revive the item.
+    // Detached items are unreachable for lookups and must not touch
+    // their shard, the cache may be gone already. The flag is checked
+    // again under the lock, since the cache may be emptied meanwhile.
+    CacheShard *shard = NULL;
+    if (!ass_atomic_load(&item->detached)) {
+        shard = item->shard;
+        ass_mutex_lock(&shard->lock);
+        if (item->detached) {
+            ass_mutex_unlock(&shard->lock);
+            shard = NULL;
+        }
+    }
+    if (ass_atomic_dec(&item->ref_count)) {
+        if (shard)
+            ass_mutex_unlock(&shard->lock);
+        return;
+    }
 
-        cache->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+    if (shard) {
+        unlink_item(shard, item);
+        shard->cache_size -= item_cost(item);
+        ass_mutex_unlock(&shard->lock);
     }
     destroy_item(item->desc, item);
 }
 
-void ass_cache_cut(Cache *cache, size_t max_size)
+static CacheItem *shard_cut(CacheShard *shard, size_t max_size)
 {
-    if (cache->cache_size <= max_size)
-        return;
+    CacheItem *destroy_list = NULL;
+    if (shard->cache_size <= max_size)
+        return NULL;
 
     do {
-        CacheItem *item = cache->queue_first;
-        if (!item)
+        // stop at items that are still being constructed,
+        // everything queued after them is even more recent
+        CacheItem *item = shard->queue_first;
+        if (!item || !item->size)
             break;
-        assert(item->size);
 
-        cache->queue_first = item->queue_next;
-        if (--item->ref_count) {
+        shard->queue_first = item->queue_next;
+        if (ass_atomic_dec(&item->ref_count)) {
+            // still referenced, so it stays in the table and can be
+            // queued again; only count it once it is actually dropped
             item->queue_prev = NULL;
             continue;
         }
 
-        if (item->next)
-            item->next->prev = item->prev;
-        *item->prev = item->next;
-
-        cache->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
-        destroy_item(cache->desc, item);
-    } while (cache->cache_size > max_size);
-    if (cache->queue_first)
-        cache->queue_first->queue_prev = &cache->queue_first;
+        unlink_item(shard, item);
+        shard->cache_size -= item_cost(item);
+        shard->stats.evictions++;
+        shard->stats.evicted_size += item_cost(item);
+        item->queue_next = destroy_list;
+        destroy_list = item;
+    } while (shard->cache_size > max_size);
+    if (shard->queue_first)
+        shard->queue_first->queue_prev = &shard->queue_first;
     else
-        cache->queue_last = &cache->queue_first;
+        shard->queue_last = &shard->queue_first;
+    return destroy_list;
 }
 
-void ass_cache_empty(Cache *cache)
+// Evict least recently used items until the total size is within max_size.
+// Every shard gives up the same fraction of its size, which approximates
+// a common LRU order without locking all shards at once. Shards that fall
+// short because their remaining items are still referenced are left out
+// and their part of the excess is spread over the others.
+void ass_cache_cut(Cache *cache, size_t max_size)
+{
+    size_t sizes[CACHE_SHARDS];
+    bool can_cut[CACHE_SHARDS];
+    size_t total = 0;
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        CacheShard *shard = &cache->shards[i];
+        ass_mutex_lock(&shard->lock);
+        sizes[i] = shard->cache_size;
+        ass_mutex_unlock(&shard->lock);
+        can_cut[i] = true;
+        total += sizes[i];
+    }
+
+    bool retry = true;
+    while (retry && total > max_size) {
+        size_t cuttable = 0;
+        for (int i = 0; i < CACHE_SHARDS; i++)
+            if (can_cut[i])
+                cuttable += sizes[i];
+        if (!cuttable)
+            break;
+        double keep = 1 - FFMIN((double) (total - max_size) / cuttable, 1);
+
+        retry = false;
+        total = 0;
+        for (int i = 0; i < CACHE_SHARDS; i++) {
+            CacheShard *shard = &cache->shards[i];
+            if (can_cut[i]) {
+                size_t shard_max_size = sizes[i] * keep;
+                ass_mutex_lock(&shard->lock);
+                CacheItem *destroy_list = shard_cut(shard, shard_max_size);
+                sizes[i] = shard->cache_size;
+                ass_mutex_unlock(&shard->lock);
+                destroy_item_list(cache->desc, destroy_list);
+                if (sizes[i] > shard_max_size) {
+                    can_cut[i] = false;
+                    retry = true;
+                }
+            }
+            total += sizes[i];
+        }
+    }
+}
+
+// Total size of all items, including referenced ones that cannot be cut
+size_t ass_cache_size(Cache *cache)
+{
+    size_t size = 0;
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        CacheShard *shard = &cache->shards[i];
+        ass_mutex_lock(&shard->lock);
+        size += shard->cache_size;
+        ass_mutex_unlock(&shard->lock);
+    }
+    return size;
+}
+
+void ass_cache_get_stats(Cache *cache, ASS_CacheStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        CacheShard *shard = &cache->shards[i];
+        ass_mutex_lock(&shard->lock);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->construct_ns += shard->stats.construct_ns;
+        stats->evictions += shard->stats.evictions;
+        stats->evicted_size += shard->stats.evicted_size;
+        stats->items += shard->n_items;
+        stats->size += shard->cache_size;
+        ass_mutex_unlock(&shard->lock);
+    }
+}
+
+static CacheItem *empty_table(CacheItem **map, size_t buckets,
+                              CacheItem *destroy_list)
 {
-    for (int i = 0; i < cache->buckets; i++) {
-        CacheItem *item = cache->map[i];
+    for (size_t i = 0; i < buckets; i++) {
+        CacheItem *item = map[i];
         while (item) {
             assert(item->size);
             CacheItem *next = item->next;
-            if (item->queue_prev)
-                item->ref_count--;
-            if (item->ref_count)
-                item->cache = NULL;
-            else
-                destroy_item(cache->desc, item);
+            ass_atomic_inc(&item->detached);
+            if (!item->queue_prev || ass_atomic_dec(&item->ref_count))
+                item->queue_prev = NULL;
+            else {
+                item->queue_next = destroy_list;
+                destroy_list = item;
+            }
             item = next;
         }
-        cache->map[i] = NULL;
     }
+    return destroy_list;
+}
+
+// Tables are released as well, an emptied cache starts small again
+static CacheItem *shard_empty(CacheShard *shard)
+{
+    CacheItem *destroy_list = NULL;
+    if (shard->old_map)
+        destroy_list = empty_table(shard->old_map + shard->rehash_pos,
+                                   shard->old_buckets - shard->rehash_pos,
+                                   destroy_list);
+    destroy_list = empty_table(shard->map, shard->buckets, destroy_list);
+    free(shard->old_map);
+    free(shard->map);
+    shard->map = shard->old_map = NULL;
+    shard->buckets = shard->old_buckets = shard->rehash_pos = 0;
+    shard->n_items = 0;
+
+    shard->queue_first = NULL;
+    shard->queue_last = &shard->queue_first;
+    shard->cache_size = 0;
+    return destroy_list;
+}
 
-    cache->queue_first = NULL;
-    cache->queue_last = &cache->queue_first;
-    cache->cache_size = 0;
+// Waits for values under construction on other threads, since those
+// cannot be destroyed yet and may depend on what prompted emptying.
+void ass_cache_empty(Cache *cache)
+{
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        CacheShard *shard = &cache->shards[i];
+        ass_mutex_lock(&shard->lock);
+        while (shard->n_constructing)
+            ass_cond_wait(&shard->construct_done, &shard->lock);
+        CacheItem *destroy_list = shard_empty(shard);
+        ass_mutex_unlock(&shard->lock);
+        destroy_item_list(cache->desc, destroy_list);
+    }
 }
 
 void ass_cache_done(Cache *cache)
 {
+    if (!cache)
+        return;
     ass_cache_empty(cache);
-    free(cache->map);
+    for (int i = 0; i < CACHE_SHARDS; i++)
+        shard_done(&cache->shards[i]);
     free(cache);
 }
 
@@ -574,3 +971,8 @@ Cache *ass_composite_cache_create(void)
 {
     return ass_cache_create(&composite_cache_desc);
 }
+
+Cache *ass_layout_cache_create(void)
+{
+    return ass_cache_create(&layout_cache_desc);
+}
@@ -42,6 +42,25 @@ typedef struct {
     int asc, desc;  // ascender/descender
 } OutlineHashValue;
 
+struct glyph_info;
+struct line_info;
+
+// glyphs and lines are a TextInfo snapshot after layout; continuations
+// of glyph clusters are stored after the first n_glyphs entries.
+// Outlines used by the glyphs are referenced in outlines.
+typedef struct {
+    bool valid;
+    struct glyph_info *glyphs;
+    int n_glyphs;
+    struct line_info *lines;
+    int n_lines;
+    double height;
+    int border_top, border_bottom, border_x;
+    ASS_DRect bbox;
+    OutlineHashValue **outlines;
+    size_t n_outlines;
+} LayoutHashValue;
+
 // Create definitions for bitmap, outline and composite hash keys
 #define CREATE_STRUCT_DEFINITIONS
 #include "ass_cache_template.h"
@@ -104,6 +123,8 @@ void *ass_cache_key(void *value);
 void ass_cache_inc_ref(void *value);
 void ass_cache_dec_ref(void *value);
 void ass_cache_cut(Cache *cache, size_t max_size);
+size_t ass_cache_size(Cache *cache);
+void ass_cache_get_stats(Cache *cache, ASS_CacheStats *stats);
 void ass_cache_empty(Cache *cache);
 void ass_cache_done(Cache *cache);
 Cache *ass_font_cache_create(void);
@@ -112,5 +133,6 @@ Cache *ass_face_size_metrics_cache_create(void);
 Cache *ass_glyph_metrics_cache_create(void);
 Cache *ass_bitmap_cache_create(void);
 Cache *ass_composite_cache_create(void);
+Cache *ass_layout_cache_create(void);
 
 #endif                          /* LIBASS_CACHE_H */
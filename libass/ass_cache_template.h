@@ -93,6 +93,7 @@ START(glyph, glyph_hash_key)
     GENERIC(int, bold)
     GENERIC(int, italic)
     GENERIC(unsigned, flags) // glyph decoration flags
+    GENERIC(int, hinting)    // ASS_Hinting used for loading
 END(GlyphHashKey)
 
 // describes an outline drawing
@@ -102,6 +103,31 @@ START(drawing, drawing_hash_key)
     STRING(text)
 END(DrawingHashKey)
 
+// describes the input of text layout: the parsed glyphs of an event
+// and the event and track state that shaping, wrapping and alignment depend on;
+// glyphs is a GlyphInfo array and drawings the concatenated drawing texts,
+// both serialized by the renderer; on call to ass_cache_get(),
+// glyphs, drawings and language are non-owning views;
+// their contents are duplicated when inserted and the copies are freed when dropped
+START(layout, layout_hash_key)
+    GENERIC(unsigned, font_generation)
+    GENERIC(uint32_t, feature_flags)
+    GENERIC(int, kerning)
+    STRING(language)
+    GENERIC(int, alignment)
+    GENERIC(int, justify)
+    GENERIC(int, wrap_style)
+    GENERIC(int, evt_type)
+    GENERIC(int, font_encoding)
+    GENERIC(double, max_text_width)
+    GENERIC(double, screen_scale_x)
+    GENERIC(double, screen_scale_y)
+    GENERIC(double, border_scale_x)
+    GENERIC(double, border_scale_y)
+    STRING(glyphs)
+    STRING(drawings)
+END(LayoutHashKey)
+
 // describes an offset outline
 // outline is refed when inserted and unrefed when dropped
 START(border, border_hash_key)
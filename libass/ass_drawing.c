@@ -30,23 +30,12 @@
 #define DRAWING_INITIAL_POINTS 100
 #define DRAWING_INITIAL_SEGMENTS 100
 
-/*
- * \brief Free a list of tokens
- */
-static void drawing_free_tokens(ASS_DrawingToken *token)
-{
-    while (token) {
-        ASS_DrawingToken *at = token;
-        token = token->next;
-        free(at);
-    }
-}
-
-static inline bool add_node(ASS_DrawingToken **tail, ASS_TokenType type, ASS_Vector point)
+static inline bool add_node(ASS_Arena *arena, ASS_DrawingToken **tail,
+                            ASS_TokenType type, ASS_Vector point)
 {
     assert(tail && *tail);
 
-    ASS_DrawingToken *new_tail = malloc(sizeof(**tail));
+    ASS_DrawingToken *new_tail = ass_arena_alloc(arena, sizeof(**tail));
     if (!new_tail)
         return false;
     (*tail)->next = new_tail;
@@ -75,7 +64,8 @@ static inline bool get_point(const char **str, ASS_Vector *point)
  * If an allocation fails, error will be set to true.
  * \return whether three valid points were added
  */
-static bool add_3_points(const char **str, ASS_DrawingToken **tail, ASS_TokenType type, bool *error)
+static bool add_3_points(ASS_Arena *arena, const char **str, ASS_DrawingToken **tail,
+                         ASS_TokenType type, bool *error)
 {
     ASS_Vector buf[3];
 
@@ -89,9 +79,9 @@ static bool add_3_points(const char **str, ASS_DrawingToken **tail, ASS_TokenTyp
     if (!valid)
         return false;
 
-    valid = add_node(tail, type, buf[0]);
-    valid = valid && add_node(tail, type, buf[1]);
-    valid = valid && add_node(tail, type, buf[2]);
+    valid = add_node(arena, tail, type, buf[0]);
+    valid = valid && add_node(arena, tail, type, buf[1]);
+    valid = valid && add_node(arena, tail, type, buf[2]);
     if (!valid) {
         *error = true;
         return false;
@@ -107,8 +97,9 @@ static bool add_3_points(const char **str, ASS_DrawingToken **tail, ASS_TokenTyp
  * If an allocation fails, error will be set to true.
  * \return count of added points
  */
-static size_t add_many_points(const char **str, ASS_DrawingToken **tail,
-                              ASS_TokenType type, size_t batch_size, bool *error)
+static size_t add_many_points(ASS_Arena *arena, const char **str,
+                              ASS_DrawingToken **tail, ASS_TokenType type,
+                              size_t batch_size, bool *error)
 {
     ASS_Vector buf[3];
     assert(batch_size <= (sizeof(buf) / sizeof(*buf)));
@@ -130,7 +121,7 @@ static size_t add_many_points(const char **str, ASS_DrawingToken **tail,
             continue;
 
         for (size_t i = 0; i < count_batch; i++)
-            if (!add_node(tail, type, buf[i])) {
+            if (!add_node(arena, tail, type, buf[i])) {
                 *error = true;
                 return count_total - count_batch + i;
             }
@@ -140,12 +131,14 @@ static size_t add_many_points(const char **str, ASS_DrawingToken **tail,
     return count_total - count_batch;
 }
 
-static inline bool add_root_node(ASS_DrawingToken **root, ASS_DrawingToken **tail,
+static inline bool add_root_node(ASS_Arena *arena,
+                                 ASS_DrawingToken **root, ASS_DrawingToken **tail,
                                  size_t *points, ASS_Vector point, ASS_TokenType type)
 {
-    *root = *tail = calloc(1, sizeof(ASS_DrawingToken));
+    *root = *tail = ass_arena_alloc(arena, sizeof(ASS_DrawingToken));
     if (!*root)
         return false;
+    (*root)->prev = (*root)->next = NULL;
     (*root)->point = point;
     (*root)->type = type;
     *points = 1;
@@ -155,8 +148,9 @@ static inline bool add_root_node(ASS_DrawingToken **root, ASS_DrawingToken **tai
 /*
  * \brief Tokenize a drawing string into a list of ASS_DrawingToken
  * This also expands points for closing b-splines
+ * \param arena allocator of the tokens
  */
-static ASS_DrawingToken *drawing_tokenize(const char *str)
+static ASS_DrawingToken *drawing_tokenize(ASS_Arena *arena, const char *str)
 {
     const char *p = str;
     ASS_DrawingToken *root = NULL, *tail = NULL, *spline_start = NULL;
@@ -185,10 +179,10 @@ static ASS_DrawingToken *drawing_tokenize(const char *str)
                 ASS_Vector point;
                 if (!get_point(&p, &point))
                     continue;
-                if (!add_root_node(&root, &tail, &points, point, TOKEN_MOVE))
+                if (!add_root_node(arena, &root, &tail, &points, point, TOKEN_MOVE))
                     return NULL;
             }
-            points += add_many_points(&p, &tail, TOKEN_MOVE, 1, &error);
+            points += add_many_points(arena, &p, &tail, TOKEN_MOVE, 1, &error);
             break;
         case 'n':
             if (!root) {
@@ -197,20 +191,20 @@ static ASS_DrawingToken *drawing_tokenize(const char *str)
                     continue;
                 if (!m_seen)
                     return NULL;
-                if (!add_root_node(&root, &tail, &points, point, TOKEN_MOVE_NC))
+                if (!add_root_node(arena, &root, &tail, &points, point, TOKEN_MOVE_NC))
                     return NULL;
             }
-            points += add_many_points(&p, &tail, TOKEN_MOVE_NC, 1, &error);
+            points += add_many_points(arena, &p, &tail, TOKEN_MOVE_NC, 1, &error);
             break;
         case 'l':
             if (!root)
                 continue;
-            points += add_many_points(&p, &tail, TOKEN_LINE, 1, &error);
+            points += add_many_points(arena, &p, &tail, TOKEN_LINE, 1, &error);
             break;
         case 'b':
             if (!root)
                 continue;
-            points += add_many_points(&p, &tail, TOKEN_CUBIC_BEZIER, 3, &error);
+            points += add_many_points(arena, &p, &tail, TOKEN_CUBIC_BEZIER, 3, &error);
             break;
         case 's':
             if (!root)
@@ -218,7 +212,7 @@ static ASS_DrawingToken *drawing_tokenize(const char *str)
             // Only the initial 3 points are TOKEN_B_SPLINE,
             // all following ones are TOKEN_EXTEND_SPLINE
             spline_start = tail;
-            if (!add_3_points(&p, &tail, TOKEN_B_SPLINE, &error)) {
+            if (!add_3_points(arena, &p, &tail, TOKEN_B_SPLINE, &error)) {
                 spline_start = NULL;
                 break;
             }
@@ -227,14 +221,14 @@ static ASS_DrawingToken *drawing_tokenize(const char *str)
         case 'p':
             if (points < 3)
                 continue;
-            points += add_many_points(&p, &tail, TOKEN_EXTEND_SPLINE, 1, &error);
+            points += add_many_points(arena, &p, &tail, TOKEN_EXTEND_SPLINE, 1, &error);
             break;
         case 'c':
             if (!spline_start)
                 continue;
             // Close b-splines: add the first three points of the b-spline back to the end
             for (int i = 0; i < 3; i++) {
-                if (!add_node(&tail, TOKEN_EXTEND_SPLINE, spline_start->point)) {
+                if (!add_node(arena, &tail, TOKEN_EXTEND_SPLINE, spline_start->point)) {
                     error = true;
                     break;
                 }
@@ -247,14 +241,10 @@ static ASS_DrawingToken *drawing_tokenize(const char *str)
             break;
         }
         if (error)
-            goto fail;
+            return NULL;
     }
 
     return root;
-
-fail:
-    drawing_free_tokens(root);
-    return NULL;
 }
 
 /*
@@ -318,7 +308,9 @@ bool ass_drawing_parse(ASS_Outline *outline, ASS_Rect *cbox,
         return false;
     rectangle_reset(cbox);
 
-    ASS_DrawingToken *tokens = drawing_tokenize(text);
+    // tokens are freed all at once with the arena
+    ASS_Arena arena = {0};
+    ASS_DrawingToken *tokens = drawing_tokenize(&arena, text);
 
     bool started = false;
     ASS_Vector pen = {0, 0};
@@ -393,11 +385,11 @@ bool ass_drawing_parse(ASS_Outline *outline, ASS_Rect *cbox,
                 "Parsed drawing with %zu points and %zu segments",
                 outline->n_points, outline->n_segments);
 
-    drawing_free_tokens(tokens);
+    ass_arena_free(&arena);
     return true;
 
 error:
-    drawing_free_tokens(tokens);
+    ass_arena_free(&arena);
     ass_outline_free(outline);
     return false;
 }
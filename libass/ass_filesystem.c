@@ -19,6 +19,17 @@
 #include "config.h"
 #include "ass_compat.h"
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "ass_filesystem.h"
 #include "ass_utils.h"
 
@@ -412,3 +423,53 @@ void ass_close_dir(ASS_Dir *dir)
 }
 
 #endif  // Windows
+
+
+const char *ass_map_file(const char *filename, FileNameSource hint,
+                         size_t *size)
+{
+#ifdef _WIN32
+    FILE *fp = ass_open_file(filename, hint);
+    if (!fp)
+        return NULL;
+    char *buf = NULL;
+    long len;
+    if (fseek(fp, 0, SEEK_END) || (len = ftell(fp)) <= 0 ||
+            fseek(fp, 0, SEEK_SET))
+        goto fail;
+    buf = malloc(len);
+    if (!buf || fread(buf, 1, len, fp) != (size_t) len)
+        goto fail;
+    fclose(fp);
+    *size = len;
+    return buf;
+
+fail:
+    free(buf);
+    fclose(fp);
+    return NULL;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size > 0 &&
+            (uintmax_t) st.st_size <= SIZE_MAX)
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+void ass_unmap_file(const char *data, size_t size)
+{
+#ifdef _WIN32
+    free((char *) data);
+#else
+    munmap((void *) data, size);
+#endif
+}
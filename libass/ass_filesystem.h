@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifndef LIBASS_FILESYSTEM_H
 #define LIBASS_FILESYSTEM_H
@@ -29,6 +30,16 @@ typedef enum {
 
 FILE *ass_open_file(const char *filename, FileNameSource hint);
 
+/**
+ * \brief Map a whole file read-only into memory.
+ * Falls back to reading it into a buffer where mapping is not available.
+ * \param size out: file size
+ * \return file contents, or NULL on failure or if the file is empty
+ */
+const char *ass_map_file(const char *filename, FileNameSource hint,
+                         size_t *size);
+void ass_unmap_file(const char *data, size_t size);
+
 typedef struct {
     void *handle;
     char *path;
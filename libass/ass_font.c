@@ -488,7 +488,8 @@ fail:
  */
 ASS_Font *ass_font_new(ASS_Renderer *render_priv, ASS_FontDesc *desc)
 {
-    ASS_Font *font = ass_cache_get(render_priv->cache.font_cache, desc, render_priv);
+    ASS_CacheGroup *group = render_priv->cache_group;
+    ASS_Font *font = ass_cache_get(group->font_cache, desc, group);
     if (!font)
         return NULL;
     if (font->library)
@@ -498,19 +499,21 @@ ASS_Font *ass_font_new(ASS_Renderer *render_priv, ASS_FontDesc *desc)
 
 size_t ass_font_construct(void *key, void *value, void *priv)
 {
-    ASS_Renderer *render_priv = priv;
+    ASS_CacheGroup *group = priv;
     ASS_FontDesc *desc = key;
     ASS_Font *font = value;
 
-    font->library = render_priv->library;
-    font->ftlibrary = render_priv->ftlibrary;
+    font->library = group->library;
+    font->ftlibrary = group->ftlibrary;
     font->n_faces = 0;
     font->desc.family = desc->family;
     font->desc.bold = desc->bold;
     font->desc.italic = desc->italic;
     font->desc.vertical = desc->vertical;
 
-    int error = add_face(render_priv->fontselect, font, 0);
+    ass_mutex_lock(&group->font_lock);
+    int error = add_face(group->fontselect, font, 0);
+    ass_mutex_unlock(&group->font_lock);
     if (error == -1)
         font->library = NULL;
     return 1;
@@ -534,15 +537,11 @@ bool ass_face_is_postscript(FT_Face face)
 }
 
 /**
- * \brief Get face weight
+ * \brief Convert an OS/2 usWeightClass to the TrueType scale
  **/
-int ass_face_get_weight(FT_Face face)
+int ass_os2_weight(uint16_t weight_class)
 {
-    TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
-    FT_UShort os2Weight = os2 ? os2->usWeightClass : 0;
-    switch (os2Weight) {
-    case 0:
-        return 300 * !!(face->style_flags & FT_STYLE_FLAG_BOLD) + 400;
+    switch (weight_class) {
     case 1:
         return 100;
     case 2:
@@ -562,11 +561,23 @@ int ass_face_get_weight(FT_Face face)
     case 9:
         return 900;
     default:
-        return os2Weight;
+        return weight_class;
     }
 }
 
-static FT_Long fsSelection_to_style_flags(uint16_t fsSelection)
+/**
+ * \brief Get face weight
+ **/
+int ass_face_get_weight(FT_Face face)
+{
+    TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
+    FT_UShort os2Weight = os2 ? os2->usWeightClass : 0;
+    if (!os2Weight)
+        return 300 * !!(face->style_flags & FT_STYLE_FLAG_BOLD) + 400;
+    return ass_os2_weight(os2Weight);
+}
+
+FT_Long ass_os2_style_flags(uint16_t fsSelection)
 {
     FT_Long ret = 0;
 
@@ -584,7 +595,7 @@ FT_Long ass_face_get_style_flags(FT_Face face)
     // will mix in some flags that GDI ignores.
     TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
     if (os2)
-        return fsSelection_to_style_flags(os2->fsSelection);
+        return ass_os2_style_flags(os2->fsSelection);
 
     return face->style_flags;
 }
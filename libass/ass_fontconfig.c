@@ -27,7 +27,9 @@
 #include <fontconfig/fcfreetype.h>
 
 #include "ass_fontconfig.h"
+#include "ass_fontindex.h"
 #include "ass_fontselect.h"
+#include "ass_library.h"
 #include "ass_utils.h"
 
 #define MAX_NAME 100
@@ -36,6 +38,16 @@ typedef struct fc_private {
     FcConfig *config;
     FcFontSet *fallbacks;
     FcCharSet *fallback_chars;
+
+    // set if the fonts were loaded from the font index
+    // instead of fontconfig patterns
+    ASS_FontIndex *index;
+    ASS_FontCoverage *coverage;
+    char **names;
+
+    // with a valid index, fontconfig only needs its font list
+    // for fallbacks, so it is not built until the first one
+    bool fonts_built;
 } ProviderPrivate;
 
 static bool check_postscript(void *priv)
@@ -76,6 +88,21 @@ static void destroy_font(void *priv)
     FcPatternDestroy((FcPattern *) priv);
 }
 
+static bool check_glyph_indexed(void *priv, uint32_t code)
+{
+    return !code || ass_font_coverage_has_char(priv, code);
+}
+
+static void get_coverage_indexed(void *priv, uint32_t first,
+                                 uint32_t coverage[8])
+{
+    ass_font_coverage_get_page(priv, first, coverage);
+}
+
+static void destroy_font_indexed(void *priv)
+{
+}
+
 static void destroy(void *priv)
 {
     ProviderPrivate *fc = (ProviderPrivate *)priv;
@@ -85,11 +112,55 @@ static void destroy(void *priv)
     if (fc->fallbacks)
         FcFontSetDestroy(fc->fallbacks);
     FcConfigDestroy(fc->config);
+    ass_font_index_close(fc->index);
+    free(fc->coverage);
+    free(fc->names);
     free(fc);
 }
 
-static bool scan_fonts(FcConfig *config, ASS_FontProvider *provider)
+/**
+ * \brief Add a font to the index being written, along with its charset.
+ * \param pages scratch buffer for the charset pages, reused across calls
+ */
+static bool add_indexed_font(ASS_FontIndexWriter *writer, FcPattern *pat,
+                             ASS_FontProviderMetaData *meta,
+                             const char *path, int index,
+                             uint32_t **pages, size_t *max_pages)
+{
+    FcCharSet *charset;
+    size_t n_pages = 0;
+    if (FcPatternGetCharSet(pat, FC_CHARSET, 0, &charset) == FcResultMatch) {
+        FcChar32 map[FC_CHARSET_MAP_SIZE], next;
+        FcChar32 base = FcCharSetFirstPage(charset, map, &next);
+        for (; base != FC_CHARSET_DONE;
+                base = FcCharSetNextPage(charset, map, &next)) {
+            if (n_pages == *max_pages) {
+                size_t size = FFMAX(2 * *max_pages, 64);
+                if (!ASS_REALLOC_ARRAY(*pages, size * FONT_COVERAGE_PAGE_WORDS))
+                    return false;
+                *max_pages = size;
+            }
+            uint32_t *page = *pages + n_pages++ * FONT_COVERAGE_PAGE_WORDS;
+            page[0] = base;
+            memcpy(page + 1, map, sizeof(map));
+        }
+    }
+
+    meta->is_postscript = check_postscript(pat);
+    return ass_font_index_writer_add_font(writer, meta, path, index,
+                                          *pages, n_pages);
+}
+
+/**
+ * \brief Add all fontconfig fonts to the provider.
+ * \param writer font index to fill as well, or NULL;
+ * it is freed and reset if that fails
+ */
+static bool scan_fonts(FcConfig *config, ASS_FontProvider *provider,
+                       ASS_FontIndexWriter **writer)
 {
+    uint32_t *pages = NULL;
+    size_t max_pages = 0;
     int i;
     FcFontSet *fonts;
     ASS_FontProviderMetaData meta = {0};
@@ -212,14 +283,100 @@ static bool scan_fonts(FcConfig *config, ASS_FontProvider *provider)
         if (result != FcResultMatch)
             meta.postscript_name = NULL;
 
+        if (*writer && !add_indexed_font(*writer, pat, &meta, path, index,
+                                         &pages, &max_pages)) {
+            ass_font_index_writer_free(*writer);
+            *writer = NULL;
+        }
+
         FcPatternReference(pat);
         ass_font_provider_add_font(provider, &meta, path, index, (void *)pat);
     }
 
+    free(pages);
     FcFontSetDestroy(fonts);
     return true;
 }
 
+/**
+ * \brief Collect the font directories and configuration files
+ * whose modification invalidates a font index.
+ * Before the fonts are built, fontconfig only knows the configured
+ * directories; their subdirectories are found while building, and are
+ * appended after the paths already in the list.
+ */
+static bool add_index_deps(FcConfig *config, const char ***deps,
+                           size_t *n_deps)
+{
+    size_t n = *n_deps, n_known = n;
+    FcStrList *lists[] = {
+        FcConfigGetConfigFiles(config),
+        FcConfigGetFontDirs(config),
+    };
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        if (!lists[i]) {
+            ok = false;
+            continue;
+        }
+        FcChar8 *str;
+        while (ok && (str = FcStrListNext(lists[i]))) {
+            size_t j = 0;
+            while (j < n_known && strcmp((*deps)[j], (const char *) str))
+                j++;
+            if (j < n_known)
+                continue;
+            ok = ASS_REALLOC_ARRAY(*deps, n + 1);
+            if (ok)
+                (*deps)[n++] = (const char *) str;
+        }
+        FcStrListDone(lists[i]);
+    }
+    *n_deps = n;
+    return ok;
+}
+
+static bool load_index(ASS_Library *lib, ProviderPrivate *fc,
+                       const char *const *deps, size_t n_deps)
+{
+    fc->index = ass_font_index_open(lib, lib->font_index, FcGetVersion(),
+                                    deps, n_deps);
+    if (!fc->index)
+        return false;
+
+    size_t n_font = ass_font_index_size(fc->index);
+    size_t n_names = ass_font_index_names(fc->index);
+    fc->coverage = n_font ? calloc(n_font, sizeof(ASS_FontCoverage)) : NULL;
+    fc->names = n_names ? calloc(n_names, sizeof(char *)) : NULL;
+    if ((n_font && !fc->coverage) || (n_names && !fc->names)) {
+        free(fc->coverage);
+        free(fc->names);
+        fc->coverage = NULL;
+        fc->names = NULL;
+        ass_font_index_close(fc->index);
+        fc->index = NULL;
+        return false;
+    }
+    return true;
+}
+
+// the metadata points into the mapped index, which the provider
+// keeps open, so none of it needs to be copied
+static void add_index_fonts(ProviderPrivate *fc, ASS_FontProvider *provider)
+{
+    ASS_FontIndexFont font;
+    char **names = fc->names;
+    size_t n_font = ass_font_index_size(fc->index);
+    for (size_t i = 0; i < n_font; i++) {
+        if (!ass_font_index_get_font(fc->index, i, &font, names))
+            continue;
+        names += font.meta.n_family + font.meta.n_fullname;
+        fc->coverage[i] = font.coverage;
+        ass_font_provider_add_font_static(provider, &font.meta, font.path,
+                                          font.index, &fc->coverage[i]);
+    }
+}
+
 static void cache_fallbacks(ProviderPrivate *fc)
 {
     FcResult result;
@@ -227,6 +384,11 @@ static void cache_fallbacks(ProviderPrivate *fc)
     if (fc->fallbacks)
         return;
 
+    if (!fc->fonts_built) {
+        fc->fonts_built = true;
+        FcConfigBuildFonts(fc->config);
+    }
+
     // Create a suitable pattern
     FcPattern *pat = FcPatternCreate();
     if (!pat)
@@ -357,6 +519,16 @@ static ASS_FontProviderFuncs fontconfig_callbacks = {
     .get_fallback       = get_fallback,
 };
 
+// fonts loaded from the index carry their coverage as private data
+static ASS_FontProviderFuncs fontconfig_index_callbacks = {
+    .check_glyph        = check_glyph_indexed,
+    .get_coverage       = get_coverage_indexed,
+    .destroy_font       = destroy_font_indexed,
+    .destroy_provider   = destroy,
+    .get_substitutions  = get_substitutions,
+    .get_fallback       = get_fallback,
+};
+
 ASS_FontProvider *
 ass_fontconfig_add_provider(ASS_Library *lib, ASS_FontSelector *selector,
                             const char *config, FT_Library ftlib)
@@ -381,23 +553,55 @@ ass_fontconfig_add_provider(ASS_Library *lib, ASS_FontSelector *selector,
         fc->config = FcInitLoadConfig();
     }
 
-    if (fc->config)
+    size_t n_deps = 0;
+    const char **deps = NULL;
+    bool deps_ok = false;
+    if (fc->config && lib->font_index) {
+        deps_ok = add_index_deps(fc->config, &deps, &n_deps);
+        if (deps_ok)
+            load_index(lib, fc, deps, n_deps);
+    }
+
+    // scanning the font directories is what the index saves
+    if (fc->config && !fc->index) {
         rc = FcConfigBuildFonts(fc->config);
+        fc->fonts_built = true;
+    }
 
-    if (!rc || !fc->config) {
+    if (!fc->config || (!fc->index && !rc)) {
         ass_msg(lib, MSGL_ERR,
                 "No valid fontconfig configuration found!");
         FcConfigDestroy(fc->config);
+        free(deps);
         free(fc);
         return NULL;
     }
 
+    ASS_FontIndexWriter *writer = NULL;
+    if (deps_ok && !fc->index && add_index_deps(fc->config, &deps, &n_deps))
+        writer = ass_font_index_writer_new(FcGetVersion(), deps, n_deps);
+
     // create font provider
-    provider = ass_font_provider_new(selector, &fontconfig_callbacks, fc);
+    provider = ass_font_provider_new(selector, fc->index ?
+        &fontconfig_index_callbacks : &fontconfig_callbacks, fc);
+    if (!provider) {
+        ass_font_index_writer_free(writer);
+        free(deps);
+        destroy(fc);
+        return NULL;
+    }
 
-    // build database from system fonts
-    if (!scan_fonts(fc->config, provider))
+    if (fc->index) {
+        add_index_fonts(fc, provider);
+    } else if (scan_fonts(fc->config, provider, &writer)) {
+        // build database from system fonts, then keep it for next time
+        if (writer)
+            ass_font_index_writer_save(writer, lib, lib->font_index);
+    } else {
         ass_msg(lib, MSGL_ERR, "Failed to load fontconfig fonts!");
+    }
 
+    ass_font_index_writer_free(writer);
+    free(deps);
     return provider;
 }
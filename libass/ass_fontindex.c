@@ -0,0 +1,495 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "ass_fontindex.h"
+#include "ass_filesystem.h"
+#include "ass_utils.h"
+
+/*
+ * File layout, in native byte order:
+ *   IndexHeader
+ *   IndexDep[n_deps]
+ *   IndexFont[n_fonts]
+ *   data: name offset lists, coverage pages and NUL-terminated strings
+ * All references are byte offsets from the start of the file,
+ * with zero standing for an absent string.
+ */
+
+#define FONT_INDEX_MAGIC    "libassfi"
+#define FONT_INDEX_VERSION  2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;  // also rejects files of the other byte order
+    uint32_t tag;
+    uint32_t size;
+    uint32_t n_deps;
+    uint32_t n_fonts;
+    uint32_t fonts;
+} IndexHeader;
+
+typedef struct {
+    int64_t mtime;
+    uint32_t mtime_nsec;
+    uint32_t path;
+} IndexDep;
+
+typedef struct {
+    uint32_t path;
+    uint32_t postscript_name;
+    uint32_t names;  // families followed by fullnames
+    uint16_t n_family;
+    uint16_t n_fullname;
+    int32_t index;
+    int32_t weight;
+    uint32_t style_flags;
+    uint32_t is_postscript;
+    uint32_t coverage;
+    uint32_t n_pages;
+} IndexFont;
+
+struct font_index {
+    const char *data;
+    size_t size;
+    const IndexFont *fonts;
+    size_t n_fonts;
+    size_t n_names;
+};
+
+// whole seconds are too coarse for fonts installed right after
+// the index was written, so use the full precision where available
+static bool get_mtime(const char *path, int64_t *mtime, uint32_t *nsec)
+{
+    struct stat st;
+    if (stat(path, &st))
+        return false;
+    *mtime = st.st_mtime;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    *nsec = st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    *nsec = st.st_mtimespec.tv_nsec;
+#else
+    *nsec = 0;
+#endif
+    return true;
+}
+
+static bool check_range(size_t size, uint32_t offset, size_t count, size_t elem)
+{
+    return offset <= size && count <= (size - offset) / elem;
+}
+
+static const char *get_string(const ASS_FontIndex *index, uint32_t offset)
+{
+    // the file ends with a NUL, so every string in range is terminated
+    return offset && offset < index->size ? index->data + offset : NULL;
+}
+
+ASS_FontIndex *ass_font_index_open(ASS_Library *library, const char *filename,
+                                   uint32_t tag, const char *const *deps,
+                                   size_t n_deps)
+{
+    size_t size;
+    const char *data = ass_map_file(filename, FN_EXTERNAL, &size);
+    if (!data)
+        return NULL;
+
+    const IndexHeader *header = (const IndexHeader *) data;
+    if (size < sizeof(IndexHeader) + 1 || data[size - 1] ||
+            memcmp(header->magic, FONT_INDEX_MAGIC, sizeof(header->magic)) ||
+            header->version != FONT_INDEX_VERSION || header->size != size ||
+            !check_range(size, sizeof(IndexHeader), header->n_deps, sizeof(IndexDep)) ||
+            header->fonts % sizeof(uint32_t) ||
+            !check_range(size, header->fonts, header->n_fonts, sizeof(IndexFont))) {
+        ass_msg(library, MSGL_WARN, "Font index %s is invalid", filename);
+        goto fail;
+    }
+    if (header->tag != tag || header->n_deps < n_deps)
+        goto stale;
+
+    ASS_FontIndex *index = malloc(sizeof(*index));
+    if (!index)
+        goto fail;
+    index->data = data;
+    index->size = size;
+    index->fonts = (const IndexFont *) (data + header->fonts);
+    index->n_fonts = header->n_fonts;
+    index->n_names = 0;
+    for (size_t i = 0; i < index->n_fonts; i++)
+        index->n_names += index->fonts[i].n_family + index->fonts[i].n_fullname;
+
+    // the dependencies found while the index was written follow
+    // the ones the caller knows about, and are checked as well
+    const IndexDep *dep = (const IndexDep *) (header + 1);
+    for (size_t i = 0; i < header->n_deps; i++) {
+        const char *path = get_string(index, dep[i].path);
+        int64_t mtime = -1;
+        uint32_t nsec = 0;
+        if (!path || (i < n_deps && strcmp(path, deps[i]))) {
+            free(index);
+            goto stale;
+        }
+        get_mtime(path, &mtime, &nsec);
+        if (mtime != dep[i].mtime || nsec != dep[i].mtime_nsec) {
+            free(index);
+            goto stale;
+        }
+    }
+    return index;
+
+stale:
+    ass_msg(library, MSGL_INFO, "Font index %s is out of date", filename);
+fail:
+    ass_unmap_file(data, size);
+    return NULL;
+}
+
+void ass_font_index_close(ASS_FontIndex *index)
+{
+    if (!index)
+        return;
+    ass_unmap_file(index->data, index->size);
+    free(index);
+}
+
+size_t ass_font_index_size(const ASS_FontIndex *index)
+{
+    return index->n_fonts;
+}
+
+size_t ass_font_index_names(const ASS_FontIndex *index)
+{
+    return index->n_names;
+}
+
+bool ass_font_index_get_font(const ASS_FontIndex *index, size_t n,
+                             ASS_FontIndexFont *font, char **names)
+{
+    const IndexFont *rec = index->fonts + n;
+    size_t n_names = rec->n_family + rec->n_fullname;
+    if (!rec->n_family || rec->n_family > FONT_INDEX_MAX_NAMES ||
+            rec->n_fullname > FONT_INDEX_MAX_NAMES ||
+            rec->names % sizeof(uint32_t) || rec->coverage % sizeof(uint32_t) ||
+            !check_range(index->size, rec->names, n_names, sizeof(uint32_t)) ||
+            !check_range(index->size, rec->coverage, rec->n_pages,
+                         FONT_COVERAGE_PAGE_WORDS * sizeof(uint32_t)))
+        return false;
+
+    const uint32_t *offsets = (const uint32_t *) (index->data + rec->names);
+    for (size_t i = 0; i < n_names; i++)
+        if (!(names[i] = (char *) get_string(index, offsets[i])))
+            return false;
+
+    font->path = get_string(index, rec->path);
+    if (!font->path)
+        return false;
+    font->index = rec->index;
+    font->coverage.pages = (const uint32_t *) (index->data + rec->coverage);
+    font->coverage.n_pages = rec->n_pages;
+
+    ASS_FontProviderMetaData *meta = &font->meta;
+    memset(meta, 0, sizeof(*meta));
+    meta->families = names;
+    meta->fullnames = names + rec->n_family;
+    meta->n_family = rec->n_family;
+    meta->n_fullname = rec->n_fullname;
+    meta->postscript_name = (char *) get_string(index, rec->postscript_name);
+    meta->style_flags = rec->style_flags;
+    meta->weight = rec->weight;
+    meta->is_postscript = rec->is_postscript;
+    return true;
+}
+
+static const uint32_t *find_coverage_page(const ASS_FontCoverage *coverage,
+                                          uint32_t base)
+{
+    size_t lo = 0, hi = coverage->n_pages;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const uint32_t *page = coverage->pages + mid * FONT_COVERAGE_PAGE_WORDS;
+        if (page[0] == base)
+            return page;
+        if (page[0] < base)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+bool ass_font_coverage_has_char(const ASS_FontCoverage *coverage, uint32_t code)
+{
+    const uint32_t *page = find_coverage_page(coverage, code & ~0xFF);
+    return page && page[1 + (code & 0xFF) / 32] >> (code % 32) & 1;
+}
+
+void ass_font_coverage_get_page(const ASS_FontCoverage *coverage,
+                                uint32_t first, uint32_t bits[8])
+{
+    const uint32_t *page = find_coverage_page(coverage, first);
+    if (page)
+        memcpy(bits, page + 1, 8 * sizeof(uint32_t));
+    else
+        memset(bits, 0, 8 * sizeof(uint32_t));
+}
+
+
+typedef struct {
+    char *data;
+    size_t size, capacity;
+} Buffer;
+
+struct font_index_writer {
+    Buffer fonts, data;
+    uint32_t tag;
+    size_t n_deps;
+    IndexDep *deps;
+};
+
+static bool buffer_append(Buffer *buf, const void *data, size_t size,
+                          uint32_t *offset)
+{
+    if (size > UINT32_MAX - buf->size)
+        return false;
+    if (buf->size + size > buf->capacity) {
+        size_t capacity = FFMAX(FFMAX(2 * buf->capacity, buf->size + size), 4096);
+        if (!ASS_REALLOC_ARRAY(buf->data, capacity))
+            return false;
+        buf->capacity = capacity;
+    }
+    if (offset)
+        *offset = buf->size;
+    memcpy(buf->data + buf->size, data, size);
+    buf->size += size;
+    return true;
+}
+
+static bool buffer_append_aligned(Buffer *buf, const void *data, size_t size,
+                                  uint32_t *offset)
+{
+    static const char zero[sizeof(uint32_t)];
+    size_t pad = -buf->size % sizeof(uint32_t);
+    return buffer_append(buf, zero, pad, NULL) &&
+        buffer_append(buf, data, size, offset);
+}
+
+static bool buffer_append_string(Buffer *buf, const char *str, uint32_t *offset)
+{
+    *offset = 0;
+    return !str || buffer_append(buf, str, strlen(str) + 1, offset);
+}
+
+ASS_FontIndexWriter *ass_font_index_writer_new(uint32_t tag,
+                                               const char *const *deps,
+                                               size_t n_deps)
+{
+    ASS_FontIndexWriter *writer = calloc(1, sizeof(*writer));
+    if (!writer)
+        return NULL;
+    writer->tag = tag;
+
+    // leave offset zero unused so it can mark absent strings
+    if (!buffer_append(&writer->data, "", 1, NULL))
+        goto fail;
+
+    writer->deps = n_deps ? calloc(n_deps, sizeof(IndexDep)) : NULL;
+    if (n_deps && !writer->deps)
+        goto fail;
+    writer->n_deps = n_deps;
+    for (size_t i = 0; i < n_deps; i++) {
+        if (!buffer_append_string(&writer->data, deps[i], &writer->deps[i].path))
+            goto fail;
+        // missing paths are recorded too, so that creating them invalidates
+        if (!get_mtime(deps[i], &writer->deps[i].mtime,
+                       &writer->deps[i].mtime_nsec)) {
+            writer->deps[i].mtime = -1;
+            writer->deps[i].mtime_nsec = 0;
+        }
+    }
+    return writer;
+
+fail:
+    ass_font_index_writer_free(writer);
+    return NULL;
+}
+
+void ass_font_index_writer_free(ASS_FontIndexWriter *writer)
+{
+    if (!writer)
+        return;
+    free(writer->fonts.data);
+    free(writer->data.data);
+    free(writer->deps);
+    free(writer);
+}
+
+bool ass_font_index_writer_add_font(ASS_FontIndexWriter *writer,
+                                    const ASS_FontProviderMetaData *meta,
+                                    const char *path, int index,
+                                    const uint32_t *coverage, size_t n_pages)
+{
+    if (!meta->n_family || !path)
+        return false;
+
+    int n_family = FFMIN(meta->n_family, FONT_INDEX_MAX_NAMES);
+    int n_fullname = FFMIN(meta->n_fullname, FONT_INDEX_MAX_NAMES);
+    uint32_t names[2 * FONT_INDEX_MAX_NAMES];
+    for (int i = 0; i < n_family; i++)
+        if (!buffer_append_string(&writer->data, meta->families[i], &names[i]))
+            return false;
+    for (int i = 0; i < n_fullname; i++)
+        if (!buffer_append_string(&writer->data, meta->fullnames[i],
+                                  &names[n_family + i]))
+            return false;
+
+    IndexFont rec = {
+        .n_family = n_family,
+        .n_fullname = n_fullname,
+        .index = index,
+        .weight = meta->weight,
+        .style_flags = meta->style_flags,
+        .is_postscript = meta->is_postscript,
+        .n_pages = n_pages,
+    };
+    if (n_pages > UINT32_MAX / (FONT_COVERAGE_PAGE_WORDS * sizeof(uint32_t)))
+        return false;
+    return buffer_append_string(&writer->data, path, &rec.path) &&
+        buffer_append_string(&writer->data, meta->postscript_name,
+                             &rec.postscript_name) &&
+        buffer_append_aligned(&writer->data, names,
+                              (n_family + n_fullname) * sizeof(uint32_t),
+                              &rec.names) &&
+        buffer_append_aligned(&writer->data, coverage,
+                              n_pages * FONT_COVERAGE_PAGE_WORDS * sizeof(uint32_t),
+                              &rec.coverage) &&
+        buffer_append(&writer->fonts, &rec, sizeof(rec), NULL);
+}
+
+static bool write_file(const char *filename, const Buffer *parts, int n_parts)
+{
+    size_t len = strlen(filename);
+    char *tmp = malloc(len + 8);
+    if (!tmp)
+        return false;
+    memcpy(tmp, filename, len);
+
+    // write next to the target and rename over it, so concurrent
+    // readers never see a partial file
+#ifdef _WIN32
+    strcpy(tmp + len, ".tmp");
+    FILE *fp = fopen(tmp, "wb");
+#else
+    strcpy(tmp + len, ".XXXXXX");
+    int fd = mkstemp(tmp);
+    if (fd >= 0)
+        fchmod(fd, 0644);
+    FILE *fp = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (fd >= 0 && !fp)
+        close(fd);
+#endif
+    if (!fp) {
+        free(tmp);
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < n_parts; i++)
+        ok &= fwrite(parts[i].data, 1, parts[i].size, fp) == parts[i].size;
+    ok &= !fclose(fp);
+#ifdef _WIN32
+    if (ok)
+        remove(filename);
+#endif
+    ok = ok && !rename(tmp, filename);
+    if (!ok)
+        remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+static void relocate(uint32_t *offset, uint32_t base)
+{
+    if (*offset)
+        *offset += base;
+}
+
+bool ass_font_index_writer_save(ASS_FontIndexWriter *writer,
+                                ASS_Library *library, const char *filename)
+{
+    // terminate the file so that reading strings can never run past it
+    if (!buffer_append(&writer->data, "", 1, NULL))
+        return false;
+
+    size_t n_fonts = writer->fonts.size / sizeof(IndexFont);
+    size_t fonts = sizeof(IndexHeader) + writer->n_deps * sizeof(IndexDep);
+    size_t base = fonts + writer->fonts.size;
+    if (base > UINT32_MAX - writer->data.size)
+        return false;
+
+    IndexHeader header = {
+        .magic = FONT_INDEX_MAGIC,
+        .version = FONT_INDEX_VERSION,
+        .tag = writer->tag,
+        .size = base + writer->data.size,
+        .n_deps = writer->n_deps,
+        .n_fonts = n_fonts,
+        .fonts = fonts,
+    };
+
+    // turn offsets into the data area into file offsets;
+    // all parts before it keep the alignment of its words
+    for (size_t i = 0; i < writer->n_deps; i++)
+        relocate(&writer->deps[i].path, base);
+    IndexFont *rec = (IndexFont *) writer->fonts.data;
+    for (size_t i = 0; i < n_fonts; i++) {
+        uint32_t *names = (uint32_t *) (writer->data.data + rec[i].names);
+        for (int j = 0; j < rec[i].n_family + rec[i].n_fullname; j++)
+            relocate(names + j, base);
+        relocate(&rec[i].path, base);
+        relocate(&rec[i].postscript_name, base);
+        relocate(&rec[i].names, base);
+        relocate(&rec[i].coverage, base);
+    }
+
+    Buffer parts[] = {
+        { (char *) &header, sizeof(header), 0 },
+        { (char *) writer->deps, writer->n_deps * sizeof(IndexDep), 0 },
+        writer->fonts,
+        writer->data,
+    };
+    if (!write_file(filename, parts, sizeof(parts) / sizeof(*parts))) {
+        ass_msg(library, MSGL_WARN, "Failed to write font index %s", filename);
+        return false;
+    }
+    ass_msg(library, MSGL_INFO, "Wrote font index %s with %zu fonts",
+            filename, n_fonts);
+    return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_FONTINDEX_H
+#define LIBASS_FONTINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ass.h"
+#include "ass_fontselect.h"
+
+/*
+ * Serialized list of the fonts of a system font provider, so that later
+ * renderers can fill the font database without enumerating the system
+ * fonts again. The file is memory-mapped when loaded and every string
+ * and coverage table handed out points into the mapping.
+ *
+ * The index records a list of dependencies, typically font directories
+ * and configuration files, along with their modification times. It is
+ * considered stale and ignored as soon as any of them differ.
+ */
+typedef struct font_index ASS_FontIndex;
+typedef struct font_index_writer ASS_FontIndexWriter;
+
+#define FONT_INDEX_MAX_NAMES 100
+
+/*
+ * Character coverage of a font as a sorted list of pages,
+ * each page being the first codepoint of a block of 256
+ * followed by 8 words of bits.
+ */
+typedef struct {
+    const uint32_t *pages;
+    size_t n_pages;
+} ASS_FontCoverage;
+
+#define FONT_COVERAGE_PAGE_WORDS 9
+
+typedef struct {
+    ASS_FontProviderMetaData meta;
+    const char *path;
+    int index;
+    ASS_FontCoverage coverage;
+} ASS_FontIndexFont;
+
+/**
+ * \brief Load an index if it exists and is up to date.
+ * \param tag provider-specific version, must match the one it was written with
+ * \param deps dependency paths, must match the first ones it was written with;
+ * any further dependencies it was written with are checked as well
+ * \return the index, or NULL if it is missing, corrupt or stale
+ */
+ASS_FontIndex *ass_font_index_open(ASS_Library *library, const char *filename,
+                                   uint32_t tag, const char *const *deps,
+                                   size_t n_deps);
+void ass_font_index_close(ASS_FontIndex *index);
+
+size_t ass_font_index_size(const ASS_FontIndex *index);
+
+/**
+ * \brief Total number of family names and fullnames over all fonts.
+ */
+size_t ass_font_index_names(const ASS_FontIndex *index);
+
+/**
+ * \brief Read a font record. The result stays valid until the index is closed.
+ * \param names receives the pointers to the family names followed by
+ * the fullnames, meta.n_family + meta.n_fullname of them
+ */
+bool ass_font_index_get_font(const ASS_FontIndex *index, size_t n,
+                             ASS_FontIndexFont *font, char **names);
+
+bool ass_font_coverage_has_char(const ASS_FontCoverage *coverage, uint32_t code);
+
+/**
+ * \brief Copy the bits of the page starting at first, zero if it is absent.
+ */
+void ass_font_coverage_get_page(const ASS_FontCoverage *coverage,
+                                uint32_t first, uint32_t bits[8]);
+
+/**
+ * \brief Start a new index.
+ * Modification times of the dependencies are taken right away,
+ * so changes made while the fonts are being collected invalidate it.
+ * \param tag provider-specific version
+ * \param deps dependency paths, typically font directories
+ */
+ASS_FontIndexWriter *ass_font_index_writer_new(uint32_t tag,
+                                               const char *const *deps,
+                                               size_t n_deps);
+void ass_font_index_writer_free(ASS_FontIndexWriter *writer);
+
+/**
+ * \brief Append a font record.
+ * \param coverage sorted pages, as in ASS_FontCoverage
+ */
+bool ass_font_index_writer_add_font(ASS_FontIndexWriter *writer,
+                                    const ASS_FontProviderMetaData *meta,
+                                    const char *path, int index,
+                                    const uint32_t *coverage, size_t n_pages);
+
+/**
+ * \brief Write all appended fonts to disk, replacing any previous index.
+ */
+bool ass_font_index_writer_save(ASS_FontIndexWriter *writer,
+                                ASS_Library *library, const char *filename);
+
+#endif /* LIBASS_FONTINDEX_H */
@@ -50,6 +50,18 @@
 #define ABS(x) ((x) < 0 ? -(x) : (x))
 #define MAX_FULLNAME 100
 
+// glyph coverage of one block of 256 codepoints
+typedef struct {
+    uint32_t key;           // block number + 1, zero for empty slots
+    uint32_t known[8];      // codepoints that have been checked
+    uint32_t covered[8];    // codepoints supported by the font
+} CoverageBlock;
+
+typedef struct {
+    CoverageBlock *blocks;  // open addressing with linear probing
+    size_t size, count;     // size is zero or a power of two
+} CoverageCache;
+
 // internal font database element
 // all strings are utf-8
 struct font_info {
@@ -80,6 +92,53 @@ struct font_info {
 
     // unused if the provider has a check_postscript function
     bool is_postscript;
+
+    // names and path are owned by the provider rather than copied
+    bool borrowed;
+
+    // check_glyph results, filled lazily
+    CoverageCache coverage;
+};
+
+// case-insensitive map from one kind of font name to the fonts having it
+typedef struct {
+    const char *name;   // owned by one of the fonts
+    unsigned hash;
+    int n_font, max_font;
+    int *fonts;         // indices into font_infos, ascending
+} FontNameEntry;
+
+typedef struct {
+    FontNameEntry *entries;  // open addressing with linear probing
+    size_t size, count;      // size is zero or a power of two
+} FontNameIndex;
+
+// memoized outcomes of ass_font_select for one block of 256 codepoints
+#define FALLBACK_MAX_RESULTS 16
+#define FALLBACK_NONE         -1
+#define FALLBACK_PATH_DEFAULT -2
+
+typedef struct {
+    char *family;
+    unsigned bold, italic;
+    uint32_t block;
+    unsigned hash;
+    int n_result;
+    int results[FALLBACK_MAX_RESULTS];  // font_infos index or FALLBACK_*
+    uint8_t choice[256];    // 1-based into results, zero if not memoized
+} FallbackEntry;
+
+typedef struct {
+    FallbackEntry **entries;  // open addressing with linear probing
+    size_t size, count;       // size is zero or a power of two
+} FallbackCache;
+
+enum {
+    NAME_FAMILY,
+    NAME_EXTENDED_FAMILY,
+    NAME_FULLNAME,
+    NAME_POSTSCRIPT,
+    NAME_KIND_COUNT
 };
 
 struct font_selector {
@@ -99,6 +158,14 @@ struct font_selector {
     int alloc_font;
     ASS_FontInfo *font_infos;
 
+    // lookup of font_infos by name; on allocation failure
+    // it is dropped and name matching falls back to a full scan
+    FontNameIndex name_index[NAME_KIND_COUNT];
+    bool name_index_failed;
+
+    // valid until the font database changes
+    FallbackCache fallback_cache;
+
     ASS_FontProvider *default_provider;
     ASS_FontProvider *embedded_provider;
 };
@@ -112,10 +179,35 @@ struct font_provider {
 typedef struct font_data_ft FontDataFT;
 struct font_data_ft {
     ASS_Library *lib;
-    FT_Face face;
+    FT_Library ftlibrary;
+    FT_Face face;       // opened on first use
     int idx;
+    int face_index;
+    bool failed;        // face could not be opened
 };
 
+/**
+ * \brief Get the face of an embedded font, opening it if needed.
+ * \return the face, or NULL if the font is unusable
+ */
+static FT_Face get_face_ft(FontDataFT *fd)
+{
+    if (fd->face || fd->failed)
+        return fd->face;
+
+    ASS_Fontdata *data = fd->lib->fontdata + fd->idx;
+    if (FT_New_Memory_Face(fd->ftlibrary, (const FT_Byte *) data->data,
+                           data->size, fd->face_index, &fd->face)) {
+        ass_msg(fd->lib, MSGL_WARN, "Error opening memory font '%s'",
+                data->name);
+        fd->face = NULL;
+        fd->failed = true;
+        return NULL;
+    }
+    ass_charmap_magic(fd->lib, fd->face);
+    return fd->face;
+}
+
 static bool check_glyph_ft(void *data, uint32_t codepoint)
 {
     FontDataFT *fd = (FontDataFT *)data;
@@ -123,14 +215,33 @@ static bool check_glyph_ft(void *data, uint32_t codepoint)
     if (!codepoint)
         return true;
 
-    return !!FT_Get_Char_Index(fd->face, codepoint);
+    FT_Face face = get_face_ft(fd);
+    return face && FT_Get_Char_Index(face, codepoint);
+}
+
+static void get_coverage_ft(void *data, uint32_t first, uint32_t coverage[8])
+{
+    FontDataFT *fd = (FontDataFT *)data;
+    FT_Face face = get_face_ft(fd);
+    FT_UInt gindex;
+
+    memset(coverage, 0, 8 * sizeof(uint32_t));
+    if (!face)
+        return;
+    FT_ULong code = first ? FT_Get_Next_Char(face, first - 1, &gindex)
+                          : FT_Get_First_Char(face, &gindex);
+    while (gindex && code - first < 256) {
+        coverage[(code - first) / 32] |= 1u << (code % 32);
+        code = FT_Get_Next_Char(face, code, &gindex);
+    }
 }
 
 static void destroy_font_ft(void *data)
 {
     FontDataFT *fd = (FontDataFT *)data;
 
-    FT_Done_Face(fd->face);
+    if (fd->face)
+        FT_Done_Face(fd->face);
     free(fd);
 }
 
@@ -157,9 +268,22 @@ get_data_embedded(void *data, unsigned char *buf, size_t offset, size_t len)
 static ASS_FontProviderFuncs ft_funcs = {
     .get_data          = get_data_embedded,
     .check_glyph       = check_glyph_ft,
+    .get_coverage      = get_coverage_ft,
     .destroy_font      = destroy_font_ft,
 };
 
+typedef struct {
+    const char *data;
+    size_t size;
+} MappedFont;
+
+static void unmap_font(void *opaque)
+{
+    MappedFont *font = opaque;
+    ass_unmap_file(font->data, font->size);
+    free(font);
+}
+
 static void load_fonts_from_dir(ASS_Library *library, const char *dir)
 {
     ASS_Dir d;
@@ -175,16 +299,340 @@ static void load_fonts_from_dir(ASS_Library *library, const char *dir)
         if (!path)
             continue;
         ass_msg(library, MSGL_INFO, "Loading font file '%s'", path);
-        size_t size = 0;
-        void *data = ass_load_file(library, path, FN_DIR_LIST, &size);
-        if (data) {
-            ass_add_font(library, name, data, size);
-            free(data);
+        // map instead of reading: most of the file is never touched
+        // unless a script actually uses the font
+        MappedFont *font = malloc(sizeof(MappedFont));
+        if (!font)
+            continue;
+        font->data = ass_map_file(path, FN_DIR_LIST, &font->size);
+        if (!font->data) {
+            ass_msg(library, MSGL_WARN, "Failed to load font file '%s'", path);
+            free(font);
+            continue;
         }
+        ass_add_font_ref(library, name, font->data, font->size,
+                         unmap_font, font);
     }
     ass_close_dir(&d);
 }
 
+static FontNameEntry *name_index_slot(const FontNameIndex *index,
+                                      const char *name, unsigned hash)
+{
+    size_t mask = index->size - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        FontNameEntry *entry = index->entries + i;
+        if (!entry->name ||
+                (entry->hash == hash && !ass_strcasecmp(entry->name, name)))
+            return entry;
+    }
+}
+
+static const FontNameEntry *name_index_get(const FontNameIndex *index,
+                                           const char *name, unsigned hash)
+{
+    if (!index->size)
+        return NULL;
+    const FontNameEntry *entry = name_index_slot(index, name, hash);
+    return entry->name ? entry : NULL;
+}
+
+static bool name_index_add(FontNameIndex *index, const char *name, int font)
+{
+    // keep the load factor at most 1/2
+    if (2 * (index->count + 1) > index->size) {
+        FontNameIndex grown = { .size = FFMAX(2 * index->size, 64) };
+        grown.entries = calloc(grown.size, sizeof(FontNameEntry));
+        if (!grown.entries)
+            return false;
+        for (size_t i = 0; i < index->size; i++) {
+            FontNameEntry *entry = index->entries + i;
+            if (entry->name)
+                *name_index_slot(&grown, entry->name, entry->hash) = *entry;
+        }
+        grown.count = index->count;
+        free(index->entries);
+        *index = grown;
+    }
+
+    unsigned hash = ass_strcasehash(name);
+    FontNameEntry *entry = name_index_slot(index, name, hash);
+    if (!entry->name) {
+        entry->name = name;
+        entry->hash = hash;
+        index->count++;
+    } else if (entry->fonts[entry->n_font - 1] == font) {
+        return true;  // same name listed twice for one font
+    }
+
+    if (entry->n_font == entry->max_font) {
+        int max_font = FFMAX(2 * entry->max_font, 4);
+        if (!ASS_REALLOC_ARRAY(entry->fonts, max_font))
+            return false;
+        entry->max_font = max_font;
+    }
+    entry->fonts[entry->n_font++] = font;
+    return true;
+}
+
+static void name_index_clear(FontNameIndex *index)
+{
+    for (size_t i = 0; i < index->size; i++)
+        free(index->entries[i].fonts);
+    free(index->entries);
+    memset(index, 0, sizeof(*index));
+}
+
+static void drop_name_index(ASS_FontSelector *selector)
+{
+    for (int k = 0; k < NAME_KIND_COUNT; k++)
+        name_index_clear(&selector->name_index[k]);
+}
+
+/**
+ * \brief Add all names of a font of the database to the name index.
+ */
+static void index_font_names(ASS_FontSelector *selector, int font)
+{
+    if (selector->name_index_failed)
+        return;
+
+    ASS_FontInfo *info = selector->font_infos + font;
+    FontNameIndex *index = selector->name_index;
+    bool ok = true;
+    for (int i = 0; i < info->n_family; i++)
+        ok &= name_index_add(&index[NAME_FAMILY], info->families[i], font);
+    if (info->extended_family)
+        ok &= name_index_add(&index[NAME_EXTENDED_FAMILY],
+                             info->extended_family, font);
+    for (int i = 0; i < info->n_fullname; i++)
+        ok &= name_index_add(&index[NAME_FULLNAME], info->fullnames[i], font);
+    if (info->postscript_name)
+        ok &= name_index_add(&index[NAME_POSTSCRIPT],
+                             info->postscript_name, font);
+
+    if (!ok) {
+        drop_name_index(selector);
+        selector->name_index_failed = true;
+    }
+}
+
+static void rebuild_name_index(ASS_FontSelector *selector)
+{
+    drop_name_index(selector);
+    selector->name_index_failed = false;
+    for (int i = 0; i < selector->n_font; i++)
+        index_font_names(selector, i);
+}
+
+static CoverageBlock *coverage_cache_slot(const CoverageCache *cache,
+                                          uint32_t key)
+{
+    size_t mask = cache->size - 1;
+    for (size_t i = (key * 2654435761u) & mask;; i = (i + 1) & mask) {
+        CoverageBlock *block = cache->blocks + i;
+        if (!block->key || block->key == key)
+            return block;
+    }
+}
+
+/**
+ * \brief Get the coverage block of a codepoint, adding an empty one if needed.
+ * \return the block, or NULL on allocation failure
+ */
+static CoverageBlock *coverage_cache_get(CoverageCache *cache, uint32_t code)
+{
+    uint32_t key = (code >> 8) + 1;
+    if (cache->size) {
+        CoverageBlock *block = coverage_cache_slot(cache, key);
+        if (block->key)
+            return block;
+    }
+
+    // keep the load factor at most 1/2
+    if (2 * (cache->count + 1) > cache->size) {
+        CoverageCache grown = { .size = FFMAX(2 * cache->size, 4) };
+        grown.blocks = calloc(grown.size, sizeof(CoverageBlock));
+        if (!grown.blocks)
+            return NULL;
+        for (size_t i = 0; i < cache->size; i++) {
+            CoverageBlock *block = cache->blocks + i;
+            if (block->key)
+                *coverage_cache_slot(&grown, block->key) = *block;
+        }
+        grown.count = cache->count;
+        free(cache->blocks);
+        *cache = grown;
+    }
+
+    CoverageBlock *block = coverage_cache_slot(cache, key);
+    block->key = key;
+    cache->count++;
+    return block;
+}
+
+static unsigned fallback_hash(const char *family, unsigned bold,
+                              unsigned italic, uint32_t block)
+{
+    unsigned hash = ass_strcasehash(family);
+    hash = (hash ^ bold) * 16777619u;
+    hash = (hash ^ italic) * 16777619u;
+    hash = (hash ^ block) * 16777619u;
+    return hash;
+}
+
+static FallbackEntry **fallback_cache_slot(const FallbackCache *cache,
+                                           const char *family, unsigned bold,
+                                           unsigned italic, uint32_t block,
+                                           unsigned hash)
+{
+    size_t mask = cache->size - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        FallbackEntry *entry = cache->entries[i];
+        if (!entry || (entry->hash == hash && entry->block == block &&
+                       entry->bold == bold && entry->italic == italic &&
+                       !strcmp(entry->family, family)))
+            return cache->entries + i;
+    }
+}
+
+static FallbackEntry *fallback_cache_find(const FallbackCache *cache,
+                                          const char *family, unsigned bold,
+                                          unsigned italic, uint32_t code)
+{
+    if (!cache->size)
+        return NULL;
+    uint32_t block = code >> 8;
+    unsigned hash = fallback_hash(family, bold, italic, block);
+    return *fallback_cache_slot(cache, family, bold, italic, block, hash);
+}
+
+/**
+ * \brief Memoize the outcome of a font selection.
+ * Failing to do so is harmless, the next call just searches again.
+ * \param result index into font_infos, or FALLBACK_NONE/FALLBACK_PATH_DEFAULT
+ */
+static void fallback_cache_add(FallbackCache *cache,
+                               const char *family, unsigned bold,
+                               unsigned italic, uint32_t code, int result)
+{
+    uint32_t block = code >> 8;
+    unsigned hash = fallback_hash(family, bold, italic, block);
+
+    FallbackEntry *entry = NULL;
+    if (cache->size)
+        entry = *fallback_cache_slot(cache, family, bold, italic, block, hash);
+
+    if (!entry) {
+        // keep the load factor at most 1/2
+        if (2 * (cache->count + 1) > cache->size) {
+            FallbackCache grown = { .size = FFMAX(2 * cache->size, 16) };
+            grown.entries = calloc(grown.size, sizeof(FallbackEntry *));
+            if (!grown.entries)
+                return;
+            for (size_t i = 0; i < cache->size; i++) {
+                FallbackEntry *old = cache->entries[i];
+                if (old)
+                    *fallback_cache_slot(&grown, old->family, old->bold,
+                                         old->italic, old->block,
+                                         old->hash) = old;
+            }
+            grown.count = cache->count;
+            free(cache->entries);
+            *cache = grown;
+        }
+
+        entry = calloc(1, sizeof(FallbackEntry));
+        if (!entry)
+            return;
+        entry->family = strdup(family);
+        if (!entry->family) {
+            free(entry);
+            return;
+        }
+        entry->bold = bold;
+        entry->italic = italic;
+        entry->block = block;
+        entry->hash = hash;
+        *fallback_cache_slot(cache, family, bold, italic, block, hash) = entry;
+        cache->count++;
+    }
+
+    int n = 0;
+    while (n < entry->n_result && entry->results[n] != result)
+        n++;
+    if (n == FALLBACK_MAX_RESULTS)
+        return;
+    if (n == entry->n_result)
+        entry->results[entry->n_result++] = result;
+    entry->choice[code & 0xFF] = n + 1;
+}
+
+static void fallback_cache_clear(FallbackCache *cache)
+{
+    for (size_t i = 0; i < cache->size; i++) {
+        FallbackEntry *entry = cache->entries[i];
+        if (entry) {
+            free(entry->family);
+            free(entry);
+        }
+    }
+    free(cache->entries);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// iterator over the fonts that may match a name, in database order
+typedef struct {
+    const FontNameEntry *lists[NAME_KIND_COUNT];
+    int pos[NAME_KIND_COUNT];
+    int n_list;
+    int next, n_font;  // for the full scan
+} FontCandidates;
+
+static void find_candidates(ASS_FontSelector *priv, FontCandidates *cand,
+                            const char *name, bool match_extended_family)
+{
+    cand->n_list = 0;
+    cand->next = 0;
+    cand->n_font = 0;
+    if (priv->name_index_failed) {
+        cand->n_font = priv->n_font;
+        return;
+    }
+
+    unsigned hash = ass_strcasehash(name);
+    for (int k = 0; k < NAME_KIND_COUNT; k++) {
+        if (k == NAME_EXTENDED_FAMILY && !match_extended_family)
+            continue;
+        const FontNameEntry *entry = name_index_get(&priv->name_index[k],
+                                                    name, hash);
+        if (entry) {
+            cand->lists[cand->n_list] = entry;
+            cand->pos[cand->n_list] = 0;
+            cand->n_list++;
+        }
+    }
+}
+
+// merge the ascending lists, skipping duplicates
+static int next_candidate(FontCandidates *cand)
+{
+    if (cand->next < cand->n_font)
+        return cand->next++;
+
+    int font = INT_MAX;
+    for (int k = 0; k < cand->n_list; k++)
+        if (cand->pos[k] < cand->lists[k]->n_font)
+            font = FFMIN(font, cand->lists[k]->fonts[cand->pos[k]]);
+    if (font == INT_MAX)
+        return -1;
+    for (int k = 0; k < cand->n_list; k++)
+        if (cand->pos[k] < cand->lists[k]->n_font &&
+                cand->lists[k]->fonts[cand->pos[k]] == font)
+            cand->pos[k]++;
+    return font;
+}
+
 /**
  * \brief Create a bare font provider.
  * \param selector parent selector. The provider will be attached to it.
@@ -219,6 +667,10 @@ static void ass_font_provider_free_fontinfo(ASS_FontInfo *info)
 {
     int j;
 
+    free(info->coverage.blocks);
+    if (info->borrowed)
+        return;
+
     if (info->fullnames) {
         for (j = 0; j < info->n_fullname; j++)
             free(info->fullnames[j]);
@@ -370,6 +822,304 @@ static void free_font_info(ASS_FontProviderMetaData *meta)
     }
 }
 
+static inline unsigned sfnt_u16(const uint8_t *p)
+{
+    return (unsigned) p[0] << 8 | p[1];
+}
+
+static inline uint32_t sfnt_u32(const uint8_t *p)
+{
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | p[2] << 8 | p[3];
+}
+
+#define SFNT_TAG(a, b, c, d) \
+    ((uint32_t) (a) << 24 | (uint32_t) (b) << 16 | (c) << 8 | (d))
+
+typedef struct {
+    const uint8_t *name, *os2;
+    uint32_t name_len, os2_len;
+    bool outlines, cff;
+    bool variable;
+} SfntTables;
+
+/**
+ * \brief Locate the tables of one face of an sfnt file (TrueType/OpenType).
+ * \param num_faces out: number of faces in the file
+ * \return whether the file is a well-formed sfnt containing that face
+ */
+static bool find_sfnt_tables(const uint8_t *data, size_t size, int face_index,
+                             int *num_faces, SfntTables *tables)
+{
+    if (size < 12)
+        return false;
+
+    size_t offset = 0;
+    if (sfnt_u32(data) == SFNT_TAG('t', 't', 'c', 'f')) {
+        uint32_t n = sfnt_u32(data + 8);
+        if (!n || n > (size - 12) / 4 || n > INT_MAX || face_index >= n)
+            return false;
+        offset = sfnt_u32(data + 12 + 4 * face_index);
+        if (offset > size - 12)
+            return false;
+        *num_faces = n;
+    } else {
+        *num_faces = 1;
+    }
+
+    const uint8_t *dir = data + offset;
+    uint32_t version = sfnt_u32(dir);
+    if (version != 0x00010000 && version != SFNT_TAG('O', 'T', 'T', 'O') &&
+            version != SFNT_TAG('t', 'r', 'u', 'e'))
+        return false;
+    unsigned num_tables = sfnt_u16(dir + 4);
+    if (num_tables > (size - offset - 12) / 16)
+        return false;
+
+    memset(tables, 0, sizeof(*tables));
+    for (unsigned i = 0; i < num_tables; i++) {
+        const uint8_t *rec = dir + 12 + 16 * i;
+        uint32_t tag = sfnt_u32(rec);
+        uint32_t pos = sfnt_u32(rec + 8), len = sfnt_u32(rec + 12);
+        if (pos > size || len > size - pos)
+            return false;
+        switch (tag) {
+        case SFNT_TAG('n', 'a', 'm', 'e'):
+            tables->name = data + pos;
+            tables->name_len = len;
+            break;
+        case SFNT_TAG('O', 'S', '/', '2'):
+            tables->os2 = data + pos;
+            tables->os2_len = len;
+            break;
+        case SFNT_TAG('g', 'l', 'y', 'f'):
+            tables->outlines = true;
+            break;
+        case SFNT_TAG('C', 'F', 'F', ' '):
+            tables->outlines = tables->cff = true;
+            break;
+        case SFNT_TAG('C', 'F', 'F', '2'):
+        case SFNT_TAG('f', 'v', 'a', 'r'):
+            tables->variable = true;
+            break;
+        }
+    }
+    return true;
+}
+
+static bool is_postscript_name_char(unsigned c)
+{
+    return c >= 33 && c <= 126 && !strchr("[](){}<>/%", c);
+}
+
+/**
+ * \brief Decode a PostScript name record the same way as FreeType.
+ * \return the name, or NULL if it contains invalid characters
+ */
+static char *get_postscript_name(const uint8_t *str, unsigned len, bool wide)
+{
+    unsigned step = wide ? 2 : 1;
+    char *name = malloc(len / step + 1), *p = name;
+    if (!name)
+        return NULL;
+    for (unsigned i = 0; i + step <= len; i += step) {
+        if ((wide && str[i]) || !is_postscript_name_char(str[i + step - 1])) {
+            free(name);
+            return NULL;
+        }
+        *p++ = str[i + step - 1];
+    }
+    *p = '\0';
+    return name;
+}
+
+/**
+ * \brief Read the same metadata as get_font_info straight from the font
+ * file, without creating a FreeType face. Only handles common static
+ * TrueType/OpenType fonts and fails on anything else, in which case
+ * the caller should use get_font_info instead.
+ * \param num_faces out: number of faces in the file
+ * \param info metadata, returned here; postscript_name is allocated
+ * \return success
+ */
+static bool
+get_font_info_sfnt(const uint8_t *data, size_t size, int face_index,
+                   int *num_faces, ASS_FontProviderMetaData *info)
+{
+    SfntTables tables;
+    if (!find_sfnt_tables(data, size, face_index, num_faces, &tables) ||
+            !tables.outlines || tables.variable ||
+            !tables.name || tables.name_len < 6 ||
+            !tables.os2 || tables.os2_len < 78)
+        return false;
+
+    unsigned weight_class = sfnt_u16(tables.os2 + 4);
+    if (!weight_class)
+        return false;
+
+    // name records with the storage bounds FreeType uses
+    const uint8_t *name = tables.name;
+    unsigned format = sfnt_u16(name);
+    unsigned count = sfnt_u16(name + 2);
+    size_t storage = sfnt_u16(name + 4);
+    size_t storage_start = 6 + 12 * (size_t) count;
+    if (storage_start > tables.name_len)
+        return false;
+    if (format == 1) {
+        if (storage_start + 2 > tables.name_len)
+            return false;
+        storage_start += 2 + 4 * (size_t) sfnt_u16(name + storage_start);
+    }
+
+    int num_fullname = 0;
+    int num_family   = 0;
+    char *fullnames[MAX_FULLNAME];
+    char *families[MAX_FULLNAME];
+    const uint8_t *ps_win = NULL, *ps_apple = NULL;
+    unsigned ps_win_len = 0, ps_apple_len = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        const uint8_t *rec = name + 6 + 12 * i;
+        unsigned platform = sfnt_u16(rec), encoding = sfnt_u16(rec + 2);
+        unsigned language = sfnt_u16(rec + 4), name_id = sfnt_u16(rec + 6);
+        unsigned len = sfnt_u16(rec + 8);
+        size_t pos = storage + sfnt_u16(rec + 10);
+        if (!len || pos < storage_start || pos + len > tables.name_len)
+            continue;
+        const uint8_t *str = name + pos;
+
+        if (platform == TT_PLATFORM_MICROSOFT &&
+                (name_id == TT_NAME_ID_FULL_NAME ||
+                 name_id == TT_NAME_ID_FONT_FAMILY)) {
+            char buf[1024];
+            ass_utf16be_to_utf8(buf, sizeof(buf), (uint8_t *) str, len);
+
+            if (name_id == TT_NAME_ID_FULL_NAME && num_fullname < MAX_FULLNAME) {
+                fullnames[num_fullname] = strdup(buf);
+                if (fullnames[num_fullname] == NULL)
+                    goto error;
+                num_fullname++;
+            }
+
+            if (name_id == TT_NAME_ID_FONT_FAMILY && num_family < MAX_FULLNAME) {
+                families[num_family] = strdup(buf);
+                if (families[num_family] == NULL)
+                    goto error;
+                num_family++;
+            }
+        }
+
+        // prefer English like FT_Get_Postscript_Name, else take the first
+        if (name_id == TT_NAME_ID_PS_NAME) {
+            if (platform == TT_PLATFORM_MICROSOFT &&
+                    (encoding == TT_MS_ID_UNICODE_CS ||
+                     encoding == TT_MS_ID_SYMBOL_CS) &&
+                    (language == TT_MS_LANGID_ENGLISH_UNITED_STATES ||
+                     !ps_win)) {
+                ps_win = str;
+                ps_win_len = len;
+            }
+            if (platform == TT_PLATFORM_MACINTOSH &&
+                    encoding == TT_MAC_ID_ROMAN &&
+                    (language == TT_MAC_LANGID_ENGLISH || !ps_apple)) {
+                ps_apple = str;
+                ps_apple_len = len;
+            }
+        }
+    }
+
+    // we absolutely need a name
+    if (num_family == 0)
+        goto error;
+
+    if (ps_win)
+        info->postscript_name = get_postscript_name(ps_win, ps_win_len, true);
+    if (!info->postscript_name && ps_apple)
+        info->postscript_name = get_postscript_name(ps_apple, ps_apple_len,
+                                                    false);
+
+    info->weight = ass_os2_weight(weight_class);
+    info->style_flags = ass_os2_style_flags(sfnt_u16(tables.os2 + 62));
+    info->is_postscript = tables.cff;
+
+    info->families = calloc(num_family, sizeof(char *));
+    if (info->families == NULL)
+        goto error;
+    memcpy(info->families, &families, sizeof(char *) * num_family);
+    info->n_family = num_family;
+
+    if (num_fullname) {
+        info->fullnames = calloc(num_fullname, sizeof(char *));
+        if (info->fullnames == NULL)
+            goto error;
+        memcpy(info->fullnames, &fullnames, sizeof(char *) * num_fullname);
+        info->n_fullname = num_fullname;
+    }
+
+    return true;
+
+error:
+    for (int i = 0; i < num_family; i++)
+        free(families[i]);
+
+    for (int i = 0; i < num_fullname; i++)
+        free(fullnames[i]);
+
+    free(info->families);
+    free(info->fullnames);
+    free(info->postscript_name);
+
+    info->families = info->fullnames = NULL;
+    info->n_family = info->n_fullname = 0;
+    info->postscript_name = NULL;
+
+    return false;
+}
+
+/**
+ * \brief Grow the font database by one entry and fill in the basic
+ * metadata. The entry only counts once add_font_info is called on it.
+ */
+static ASS_FontInfo *new_font_info(ASS_FontSelector *selector,
+                                   const ASS_FontProviderMetaData *meta)
+{
+    if (selector->n_font >= selector->alloc_font) {
+        int alloc_font = FFMAX(1, 2 * selector->alloc_font);
+        ASS_FontInfo *font_infos = realloc(selector->font_infos,
+                alloc_font * sizeof(ASS_FontInfo));
+        if (!font_infos)
+            return NULL;
+        selector->font_infos = font_infos;
+        selector->alloc_font = alloc_font;
+    }
+
+    ASS_FontInfo *info = selector->font_infos + selector->n_font;
+    memset(info, 0, sizeof(ASS_FontInfo));
+
+    // set uid
+    info->uid = selector->uid++;
+
+    info->style_flags   = meta->style_flags;
+    info->weight        = meta->weight;
+    info->n_fullname    = meta->n_fullname;
+    info->n_family      = meta->n_family;
+    info->is_postscript = meta->is_postscript;
+    return info;
+}
+
+static void add_font_info(ASS_FontProvider *provider, ASS_FontInfo *info,
+                          int index, void *data)
+{
+    ASS_FontSelector *selector = provider->parent;
+
+    info->index = index;
+    info->priv  = data;
+    info->provider = provider;
+
+    index_font_names(selector, selector->n_font);
+    selector->n_font++;
+    fallback_cache_clear(&selector->fallback_cache);
+}
+
 /**
  * \brief Add a font to a font provider.
  * \param provider the font provider
@@ -446,25 +1196,10 @@ ass_font_provider_add_font(ASS_FontProvider *provider,
     printf("  index: %d\n", index);
 #endif
 
-    // check size
-    if (selector->n_font >= selector->alloc_font) {
-        selector->alloc_font = FFMAX(1, 2 * selector->alloc_font);
-        selector->font_infos = realloc(selector->font_infos,
-                selector->alloc_font * sizeof(ASS_FontInfo));
-    }
-
     // copy over metadata
-    info = selector->font_infos + selector->n_font;
-    memset(info, 0, sizeof(ASS_FontInfo));
-
-    // set uid
-    info->uid = selector->uid++;
-
-    info->style_flags   = meta->style_flags;
-    info->weight        = meta->weight;
-    info->n_fullname    = meta->n_fullname;
-    info->n_family      = meta->n_family;
-    info->is_postscript = meta->is_postscript;
+    info = new_font_info(selector, meta);
+    if (!info)
+        goto error;
 
     info->families = calloc(meta->n_family, sizeof(char *));
     if (info->families == NULL)
@@ -506,11 +1241,7 @@ ass_font_provider_add_font(ASS_FontProvider *provider,
             goto error;
     }
 
-    info->index = index;
-    info->priv  = data;
-    info->provider = provider;
-
-    selector->n_font++;
+    add_font_info(provider, info, index, data);
 
     free_font_info(&implicit_meta);
     free(implicit_meta.postscript_name);
@@ -528,6 +1259,30 @@ error:
     return false;
 }
 
+bool
+ass_font_provider_add_font_static(ASS_FontProvider *provider,
+                                  const ASS_FontProviderMetaData *meta,
+                                  const char *path, int index, void *data)
+{
+    ASS_FontInfo *info = NULL;
+    if (meta->n_family)
+        info = new_font_info(provider->parent, meta);
+    if (!info) {
+        provider->funcs.destroy_font(data);
+        return false;
+    }
+
+    info->borrowed = true;
+    info->families = meta->families;
+    info->fullnames = meta->n_fullname ? meta->fullnames : NULL;
+    info->postscript_name = meta->postscript_name;
+    info->extended_family = meta->extended_family;
+    info->path = (char *) path;
+
+    add_font_info(provider, info, index, data);
+    return true;
+}
+
 /**
  * \brief Clean up font database. Deletes all fonts that have an invalid
  * font provider (NULL).
@@ -552,6 +1307,8 @@ static void ass_fontselect_cleanup(ASS_FontSelector *selector)
     }
 
     selector->n_font = w;
+    rebuild_name_index(selector);
+    fallback_cache_clear(&selector->fallback_cache);
 }
 
 void ass_font_provider_free(ASS_FontProvider *provider)
@@ -702,15 +1459,30 @@ static bool check_glyph(ASS_FontInfo *fi, uint32_t code)
     ASS_FontProvider *provider = fi->provider;
     assert(provider && provider->funcs.check_glyph);
 
-    return provider->funcs.check_glyph(fi->priv, code);
+    CoverageBlock *block = code ? coverage_cache_get(&fi->coverage, code) : NULL;
+    if (!block)
+        return provider->funcs.check_glyph(fi->priv, code);
+
+    unsigned word = (code & 0xFF) / 32;
+    uint32_t bit = 1u << (code % 32);
+    if (!(block->known[word] & bit)) {
+        if (provider->funcs.get_coverage) {
+            provider->funcs.get_coverage(fi->priv, code & ~0xFF,
+                                         block->covered);
+            memset(block->known, 0xFF, sizeof(block->known));
+        } else {
+            if (provider->funcs.check_glyph(fi->priv, code))
+                block->covered[word] |= bit;
+            block->known[word] |= bit;
+        }
+    }
+    return block->covered[word] & bit;
 }
 
-static char *
+static ASS_FontInfo *
 find_font(ASS_FontSelector *priv,
           ASS_FontProviderMetaData meta, bool match_extended_family,
-          unsigned bold, unsigned italic,
-          int *index, char **postscript_name, int *uid, ASS_FontStream *stream,
-          uint32_t code, bool *name_match)
+          unsigned bold, unsigned italic, uint32_t code, bool *name_match)
 {
     ASS_FontInfo req = {0};
     ASS_FontInfo *selected = NULL;
@@ -728,7 +1500,10 @@ find_font(ASS_FontSelector *priv,
     for (int i = 0; i < meta.n_fullname; i++) {
         const char *fullname = meta.fullnames[i];
 
-        for (int x = 0; x < priv->n_font; x++) {
+        // only fonts with this name in one of their name lists can match
+        FontCandidates cand;
+        find_candidates(priv, &cand, fullname, match_extended_family);
+        for (int x; (x = next_candidate(&cand)) >= 0;) {
             ASS_FontInfo *font = &priv->font_infos[x];
             unsigned score = UINT_MAX;
 
@@ -775,49 +1550,50 @@ find_font(ASS_FontSelector *priv,
             break;
     }
 
-    // found anything?
-    char *result = NULL;
-    if (selected) {
-        ASS_FontProvider *provider = selected->provider;
-
-        // successfully matched, set up return values
-        *postscript_name = selected->postscript_name;
-        *uid   = selected->uid;
-
-        // use lazy evaluation for index if applicable
-        if (provider->funcs.get_font_index) {
-            *index = provider->funcs.get_font_index(selected->priv);
-        } else
-            *index = selected->index;
-
-        // set up memory stream if there is no path
-        if (selected->path == NULL) {
-            stream->func = provider->funcs.get_data;
-            stream->priv = selected->priv;
-            // Prefer PostScript name because it is unique. This is only
-            // used for display purposes so it doesn't matter that much,
-            // though.
-            if (selected->postscript_name)
-                result = selected->postscript_name;
-            else
-                result = selected->families[0];
-        } else
-            result = selected->path;
+    return selected;
+}
 
+/**
+ * \brief Set up the return values of ass_font_select for a selected font.
+ * \return font file path, or a name for display if it has none
+ */
+static char *get_font_result(ASS_FontInfo *selected, int *index,
+                             char **postscript_name, int *uid,
+                             ASS_FontStream *stream)
+{
+    ASS_FontProvider *provider = selected->provider;
+
+    *postscript_name = selected->postscript_name;
+    *uid   = selected->uid;
+
+    // use lazy evaluation for index if applicable
+    if (provider->funcs.get_font_index) {
+        *index = provider->funcs.get_font_index(selected->priv);
+    } else
+        *index = selected->index;
+
+    // set up memory stream if there is no path
+    if (selected->path == NULL) {
+        stream->func = provider->funcs.get_data;
+        stream->priv = selected->priv;
+        // Prefer PostScript name because it is unique. This is only
+        // used for display purposes so it doesn't matter that much,
+        // though.
+        if (selected->postscript_name)
+            return selected->postscript_name;
+        return selected->families[0];
     }
 
-    return result;
+    return selected->path;
 }
 
-static char *select_font(ASS_FontSelector *priv,
-                         const char *family, bool match_extended_family,
-                         unsigned bold, unsigned italic,
-                         int *index, char **postscript_name, int *uid,
-                         ASS_FontStream *stream, uint32_t code)
+static ASS_FontInfo *select_font(ASS_FontSelector *priv,
+                                 const char *family, bool match_extended_family,
+                                 unsigned bold, unsigned italic, uint32_t code)
 {
     ASS_FontProvider *default_provider = priv->default_provider;
     ASS_FontProviderMetaData meta = {0};
-    char *result = NULL;
+    ASS_FontInfo *result = NULL;
     bool name_match = false;
 
     if (family == NULL)
@@ -840,8 +1616,7 @@ static char *select_font(ASS_FontSelector *priv,
     }
 
     result = find_font(priv, meta, match_extended_family,
-                       bold, italic, index, postscript_name, uid,
-                       stream, code, &name_match);
+                       bold, italic, code, &name_match);
 
     // If no matching font was found, it might not exist in the font list
     // yet. Call the match_fonts callback to fill in the missing fonts
@@ -856,8 +1631,7 @@ static char *select_font(ASS_FontSelector *priv,
                                                 meta.fullnames[i]);
         }
         result = find_font(priv, meta, match_extended_family,
-                           bold, italic, index, postscript_name, uid,
-                           stream, code, &name_match);
+                           bold, italic, code, &name_match);
     }
 
     // cleanup
@@ -880,6 +1654,9 @@ static char *select_font(ASS_FontSelector *priv,
  * \param index out: font index inside a file
  * \param code: the character that should be present in the font, can be 0
  * \return font file path
+ *
+ * Outcomes are memoized per request and block of 256 codepoints
+ * until the font database changes.
 */
 char *ass_font_select(ASS_FontSelector *priv,
                       const ASS_Font *font, int *index, char **postscript_name,
@@ -890,22 +1667,36 @@ char *ass_font_select(ASS_FontSelector *priv,
     unsigned bold = font->desc.bold;
     unsigned italic = font->desc.italic;
     ASS_FontProvider *default_provider = priv->default_provider;
+    ASS_FontInfo *selected = NULL;
+    bool use_family_default = false;
+
+    // The search only depends on the request and the font database,
+    // so repeat an earlier outcome if there is one.
+    const char *key = family ? family : "";
+    FallbackEntry *memo = fallback_cache_find(&priv->fallback_cache,
+                                              key, bold, italic, code);
+    if (memo && memo->choice[code & 0xFF]) {
+        int result = memo->results[memo->choice[code & 0xFF] - 1];
+        if (result >= 0)
+            return get_font_result(priv->font_infos + result, index,
+                                   postscript_name, uid, data);
+        if (result == FALLBACK_PATH_DEFAULT) {
+            *index = priv->index_default;
+            return priv->path_default;
+        }
+        return NULL;
+    }
 
     if (family && *family)
-        res = select_font(priv, family, false, bold, italic, index,
-                postscript_name, uid, data, code);
+        selected = select_font(priv, family, false, bold, italic, code);
 
-    if (!res && priv->family_default) {
-        res = select_font(priv, priv->family_default, false, bold,
-                italic, index, postscript_name, uid, data, code);
-        if (res)
-            ass_msg(priv->library, MSGL_WARN, "fontselect: Using default "
-                    "font family: (%s, %d, %d) -> %s, %d, %s",
-                    family, bold, italic, res, *index,
-                    *postscript_name ? *postscript_name : "(none)");
+    if (!selected && priv->family_default) {
+        selected = select_font(priv, priv->family_default, false, bold,
+                               italic, code);
+        use_family_default = selected != NULL;
     }
 
-    if (!res && default_provider && default_provider->funcs.get_fallback) {
+    if (!selected && default_provider && default_provider->funcs.get_fallback) {
         const char *search_family = family;
         if (!search_family || !*search_family)
             search_family = "Arial";
@@ -913,12 +1704,21 @@ char *ass_font_select(ASS_FontSelector *priv,
                 default_provider->priv, priv->library, search_family, code);
 
         if (fallback_family) {
-            res = select_font(priv, fallback_family, true, bold, italic,
-                    index, postscript_name, uid, data, code);
+            selected = select_font(priv, fallback_family, true, bold, italic,
+                                   code);
             free(fallback_family);
         }
     }
 
+    if (selected) {
+        res = get_font_result(selected, index, postscript_name, uid, data);
+        if (use_family_default)
+            ass_msg(priv->library, MSGL_WARN, "fontselect: Using default "
+                    "font family: (%s, %d, %d) -> %s, %d, %s",
+                    family, bold, italic, res, *index,
+                    *postscript_name ? *postscript_name : "(none)");
+    }
+
     if (!res && priv->path_default) {
         res = priv->path_default;
         *index = priv->index_default;
@@ -937,6 +1737,10 @@ char *ass_font_select(ASS_FontSelector *priv,
                 "fontselect: failed to find any fallback with glyph 0x%X for font: "
                 "(%s, %d, %d)", code, family, bold, italic);
 
+    fallback_cache_add(&priv->fallback_cache, key, bold, italic, code,
+                       selected ? (int) (selected - priv->font_infos) :
+                       res ? FALLBACK_PATH_DEFAULT : FALLBACK_NONE);
+
     return res;
 }
 
@@ -946,64 +1750,81 @@ char *ass_font_select(ASS_FontSelector *priv,
  * \param priv private data
  * \param idx index of the processed font in priv->library->fontdata
  *
- * Builds a FontInfo with FreeType and some table reading.
+ * Reads the metadata of each face from the sfnt tables if possible,
+ * so that faces are only created once a font is actually used.
+ * Other fonts are opened with FreeType right away.
 */
 static void process_fontdata(ASS_FontProvider *priv, int idx)
 {
     ASS_FontSelector *selector = priv->parent;
     ASS_Library *library = selector->library;
 
-    int rc;
     const char *name = library->fontdata[idx].name;
     const char *data = library->fontdata[idx].data;
-    int data_size = library->fontdata[idx].size;
+    size_t data_size = library->fontdata[idx].size;
 
-    FT_Face face;
     int face_index, num_faces = 1;
 
     for (face_index = 0; face_index < num_faces; ++face_index) {
-        ASS_FontProviderMetaData info;
+        ASS_FontProviderMetaData info = {0};
+        FT_Face face = NULL;
         FontDataFT *ft;
 
-        rc = FT_New_Memory_Face(selector->ftlibrary, (unsigned char *) data,
-                                data_size, face_index, &face);
-        if (rc) {
-            ass_msg(library, MSGL_WARN, "Error opening memory font '%s'",
-                   name);
-            continue;
-        }
+        if (!get_font_info_sfnt((const uint8_t *) data, data_size, face_index,
+                                &num_faces, &info)) {
+            int rc = FT_New_Memory_Face(selector->ftlibrary,
+                                        (const FT_Byte *) data, data_size,
+                                        face_index, &face);
+            if (rc) {
+                ass_msg(library, MSGL_WARN, "Error opening memory font '%s'",
+                       name);
+                continue;
+            }
 
-        num_faces = face->num_faces;
+            num_faces = face->num_faces;
 
-        ass_charmap_magic(library, face);
+            ass_charmap_magic(library, face);
 
-        memset(&info, 0, sizeof(ASS_FontProviderMetaData));
-        if (!get_font_info(selector->ftlibrary, face, NULL, &info)) {
-            ass_msg(library, MSGL_WARN,
-                    "Error getting metadata for embedded font '%s'", name);
-            FT_Done_Face(face);
-            continue;
+            if (!get_font_info(selector->ftlibrary, face, NULL, &info)) {
+                ass_msg(library, MSGL_WARN,
+                        "Error getting metadata for embedded font '%s'", name);
+                FT_Done_Face(face);
+                continue;
+            }
+
+            if (info.postscript_name) {
+                info.postscript_name = strdup(info.postscript_name);
+                if (!info.postscript_name) {
+                    free_font_info(&info);
+                    FT_Done_Face(face);
+                    continue;
+                }
+            }
         }
 
         ft = calloc(1, sizeof(FontDataFT));
 
         if (ft == NULL) {
             free_font_info(&info);
-            FT_Done_Face(face);
+            free(info.postscript_name);
+            if (face)
+                FT_Done_Face(face);
             continue;
         }
 
         ft->lib  = library;
+        ft->ftlibrary = selector->ftlibrary;
         ft->face = face;
         ft->idx  = idx;
+        ft->face_index = face_index;
 
-        if (!ass_font_provider_add_font(priv, &info, NULL, face_index, ft)) {
+        // ft is freed on failure
+        if (!ass_font_provider_add_font(priv, &info, NULL, face_index, ft))
             ass_msg(library, MSGL_WARN, "Failed to add embedded font '%s'",
                     name);
-            free(ft);
-        }
 
         free_font_info(&info);
+        free(info.postscript_name);
     }
 }
 
@@ -1165,6 +1986,8 @@ void ass_fontselect_free(ASS_FontSelector *priv)
     if (priv->embedded_provider)
         ass_font_provider_free(priv->embedded_provider);
 
+    drop_name_index(priv);
+    fallback_cache_clear(&priv->fallback_cache);
     free(priv->font_infos);
     free(priv->path_default);
     free(priv->family_default);
@@ -70,6 +70,19 @@ typedef bool    (*CheckPostscriptFunc)(void *font_priv);
  */
 typedef bool    (*CheckGlyphFunc)(void *font_priv, uint32_t codepoint);
 
+/**
+ * Get the glyph coverage of a block of 256 codepoints.
+ * This function is optional and allows fontselect to cache a whole block
+ * at once instead of querying check_glyph for each codepoint.
+ *
+ * \param font_priv font private data
+ * \param first first codepoint of the block, a multiple of 256
+ * \param coverage output bitmap, bit n % 32 of word n / 32 is set if
+ *        codepoint first + n is supported by the font
+ */
+typedef void    (*GetCoverageFunc)(void *font_priv, uint32_t first,
+                                   uint32_t coverage[8]);
+
 /**
 * Get index of a font in context of a font collection.
 * This function is optional and may be needed to initialize the font index
@@ -165,6 +178,7 @@ typedef struct font_provider_funcs {
     SubstituteFontFunc  get_substitutions;      /* optional */
     GetFallbackFunc     get_fallback;           /* optional */
     GetFontIndex        get_font_index;         /* optional */
+    GetCoverageFunc     get_coverage;           /* optional */
 } ASS_FontProviderFuncs;
 
 /*
@@ -285,6 +299,24 @@ ass_font_provider_add_font(ASS_FontProvider *provider,
                            ASS_FontProviderMetaData *meta, const char *path,
                            int index, void *data);
 
+/**
+ * \brief Add a font to a font provider without copying its metadata.
+ * Unlike ass_font_provider_add_font, this needs at least one family name
+ * and does not open the font. The name lists, all strings of meta and path
+ * must stay valid and unchanged until the provider is freed.
+ * \param provider the font provider
+ * \param meta font metadata
+ * \param path absolute path to font, or NULL for memory-based fonts
+ * \param index index inside a font collection file
+ * \param data private data for font callbacks
+ * \return success
+ *
+ */
+bool
+ass_font_provider_add_font_static(ASS_FontProvider *provider,
+                                  const ASS_FontProviderMetaData *meta,
+                                  const char *path, int index, void *data);
+
 /**
  * \brief Free font provider and associated fonts.
  * \param provider the font provider
@@ -58,6 +58,7 @@ void ass_library_done(ASS_Library *priv)
 {
     if (priv) {
         ass_set_fonts_dir(priv, NULL);
+        ass_set_font_index(priv, NULL);
         ass_set_style_overrides(priv, NULL);
         ass_clear_fonts(priv);
         free(priv);
@@ -71,6 +72,13 @@ void ass_set_fonts_dir(ASS_Library *priv, const char *fonts_dir)
     priv->fonts_dir = fonts_dir ? strdup(fonts_dir) : 0;
 }
 
+void ass_set_font_index(ASS_Library *priv, const char *filename)
+{
+    free(priv->font_index);
+
+    priv->font_index = filename ? strdup(filename) : NULL;
+}
+
 void ass_set_extract_fonts(ASS_Library *priv, int extract)
 {
     priv->extract_fonts = !!extract;
@@ -104,37 +112,51 @@ void ass_set_style_overrides(ASS_Library *priv, char **list)
 }
 
 void ass_add_font(ASS_Library *priv, const char *name, const char *data, int size)
+{
+    if (!name || !data || size <= 0)
+        return;
+
+    char *copy = malloc(size);
+    if (!copy)
+        return;
+    memcpy(copy, data, size);
+
+    ass_add_font_ref(priv, name, copy, size, free, copy);
+}
+
+void ass_add_font_ref(ASS_Library *priv, const char *name, const char *data,
+                      size_t size, void (*release)(void *opaque), void *opaque)
 {
     size_t idx = priv->num_fontdata;
     if (!name || !data || !size)
-        return;
+        goto error;
     if (!(idx & (idx - 32)) && // power of two >= 32, or zero --> time for realloc
             !ASS_REALLOC_ARRAY(priv->fontdata, FFMAX(2 * idx, 32)))
-        return;
+        goto error;
 
     priv->fontdata[idx].name = strdup(name);
-    priv->fontdata[idx].data = malloc(size);
-
-    if (!priv->fontdata[idx].name || !priv->fontdata[idx].data)
+    if (!priv->fontdata[idx].name)
         goto error;
 
-    memcpy(priv->fontdata[idx].data, data, size);
-
+    priv->fontdata[idx].data = data;
     priv->fontdata[idx].size = size;
+    priv->fontdata[idx].release = release;
+    priv->fontdata[idx].opaque = opaque;
 
     priv->num_fontdata++;
     return;
 
 error:
-    free(priv->fontdata[idx].name);
-    free(priv->fontdata[idx].data);
+    if (release)
+        release(opaque);
 }
 
 void ass_clear_fonts(ASS_Library *priv)
 {
     for (size_t i = 0; i < priv->num_fontdata; i++) {
         free(priv->fontdata[i].name);
-        free(priv->fontdata[i].data);
+        if (priv->fontdata[i].release)
+            priv->fontdata[i].release(priv->fontdata[i].opaque);
     }
     free(priv->fontdata);
     priv->fontdata = NULL;
@@ -25,12 +25,15 @@
 
 typedef struct {
     char *name;
-    char *data;
-    int size;
+    const char *data;
+    size_t size;
+    void (*release)(void *opaque);  // called once data is no longer needed
+    void *opaque;
 } ASS_Fontdata;
 
 struct ass_library {
     char *fonts_dir;
+    char *font_index;
     int extract_fonts;
     char **style_overrides;
 
@@ -177,6 +177,17 @@ void ass_apply_fade(uint32_t *clr, int fade)
         change_alpha(clr, mult_alpha(_a(*clr), fade), 1);
 }
 
+/**
+ * \brief Get the time elapsed since the start of the event
+ * Marks the event as animated: its output cannot be reused
+ * for frames at a different time.
+ */
+static long long event_time(RenderContext *state)
+{
+    state->animated = true;
+    return state->time - state->event->Start;
+}
+
 /**
  * \brief Calculate alpha value by piecewise linear function
  * Used for \fad, \fade implementation.
@@ -513,7 +524,7 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
                 t2 = state->event->Duration;
             }
             delta_t = (uint32_t) t2 - t1;
-            t = render_priv->time - state->event->Start;
+            t = event_time(state);
             if (t <= t1)
                 k = 0.;
             else if (t >= t2)
@@ -649,8 +660,7 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
             }
             if ((state->parsed_tags & PARSED_FADE) == 0) {
                 state->fade =
-                    interpolate_alpha(render_priv->time -
-                            state->event->Start, t1, t2,
+                    interpolate_alpha(event_time(state), t1, t2,
                             t3, t4, a1, a2, a3);
                 state->parsed_tags |= PARSED_FADE;
             }
@@ -695,7 +705,7 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
             if (t2 == 0)
                 t2 = state->event->Duration;
             delta_t = (uint32_t) t2 - t1;
-            t = render_priv->time - state->event->Start;        // FIXME: move to render_context
+            t = event_time(state);
             if (t < t1)
                 k = 0.;
             else if (t >= t2)
@@ -964,8 +974,7 @@ void ass_apply_transition_effects(RenderContext *state)
         // maxuimum there, before converting back.
         double scale_x = ((double) layout_res.x) / render_priv->track->PlayResX;
         delay = ((int) FFMAX(delay / scale_x, 1)) * scale_x;
-        state->scroll_shift =
-            (render_priv->time - event->Start) / delay;
+        state->scroll_shift = event_time(state) / delay;
         state->evt_type |= EVENT_HSCROLL;
         state->detect_collisions = 0;
         state->wrap_style = 2;
@@ -994,8 +1003,7 @@ void ass_apply_transition_effects(RenderContext *state)
         // See explanation for Banner
         double scale_y = ((double) layout_res.y) / render_priv->track->PlayResY;
         delay = ((int) FFMAX(delay / scale_y, 1)) * scale_y;
-        state->scroll_shift =
-            (render_priv->time - event->Start) / delay;
+        state->scroll_shift = event_time(state) / delay;
         if (v[0] < v[1]) {
             y0 = v[0];
             y1 = v[1];
@@ -1025,7 +1033,7 @@ void ass_apply_transition_effects(RenderContext *state)
 void ass_process_karaoke_effects(RenderContext *state)
 {
     TextInfo *text_info = &state->text_info;
-    long long tm_current = state->renderer->time - state->event->Start;
+    long long tm_current = state->time - state->event->Start;
 
     int32_t timing = 0, skip_timing = 0;
     Effect effect_type = EF_NONE;
@@ -1058,6 +1066,8 @@ void ass_process_karaoke_effects(RenderContext *state)
             effect_type = start->effect_type;
         if (effect_type == EF_NONE)
             continue;
+        // the karaoke state depends on tm_current
+        state->animated = true;
 
         if (start->reset_effect)
             timing = 0;
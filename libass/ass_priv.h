@@ -49,12 +49,20 @@ typedef enum {
     // max 32 enumerators
 } ScriptInfo;
 
+typedef struct {
+    long long start, end;
+    long long end_max;  // max end of this and all preceding entries
+    int event;
+} EventIndexEntry;
+
 struct parser_priv {
     ParserState state;
     char *fontname;
-    char *fontdata;
+    unsigned char *fontdata;    // decoded so far
     size_t fontdata_size;
     size_t fontdata_used;
+    unsigned char fontdata_pending[4];  // characters of an incomplete group
+    int fontdata_n_pending;
 
     // contains bitmap of ReadOrder IDs of all read events
     uint32_t *read_order_bitmap;
@@ -68,6 +76,32 @@ struct parser_priv {
 
     long long prune_delay;
     long long prune_next_ts;
+
+    // events sorted by start time, used by ass_find_active_events();
+    // covers the first event_index_count events of the track,
+    // later ones get merged in lazily on the next lookup
+    EventIndexEntry *event_index;
+    int event_index_count;
+    int event_index_max;
+    int *active_events;
+    int active_events_max;
+
+    // NUL-terminated copy of the chunk being parsed by ass_process_chunk(),
+    // kept to avoid an allocation per chunk
+    char *chunk_buf;
+    size_t chunk_buf_size;
+
+    // Identify the rendering-relevant state of the track, so that
+    // renderers can tell whether a previous frame is still up to date.
+    // track_id is unique among all tracks ever created; generation is
+    // incremented whenever events are removed, styles or track settings
+    // change, or ass_track_invalidate() is called.
+    size_t track_id;
+    unsigned generation;
 };
 
+int ass_find_active_events(ASS_Track *track, long long now, int **events);
+int ass_advance_active_events(ASS_Track *track, long long now,
+                              size_t *cursor, int **events);
+
 #endif /* LIBASS_PRIV_H */
@@ -20,6 +20,7 @@
 #include "ass_compat.h"
 
 #include <assert.h>
+#include <string.h>
 #ifdef _MSC_VER
 #include <intrin.h>
 #pragma intrinsic(_BitScanReverse)
@@ -719,9 +720,15 @@ static bool rasterizer_fill_level(const BitmapEngine *engine, RasterizerData *rs
     return true;
 }
 
-bool ass_rasterizer_fill(const BitmapEngine *engine, RasterizerData *rst,
-                         uint8_t *buf, int x0, int y0,
-                         int width, int height, ptrdiff_t stride)
+/**
+ * \brief Move the polyline into window coordinates and drop everything
+ * outside of the window
+ * \param n_lines, winding out: initial parameters for rasterizer_fill_level()
+ * \return false on error
+ */
+static bool rasterizer_fill_prepare(const BitmapEngine *engine, RasterizerData *rst,
+                                    int x0, int y0, int width, int height,
+                                    size_t n_lines[2], int winding[2])
 {
     assert(width > 0 && height > 0);
     assert(!(width  & ((1 << engine->tile_order) - 1)));
@@ -746,8 +753,9 @@ bool ass_rasterizer_fill(const BitmapEngine *engine, RasterizerData *rst,
         return false;
 
     size_t n_unused[2];
-    size_t n_lines[2] = { rst->n_first, rst->size[0] - rst->n_first };
-    int winding[2] = { 0, 0 };
+    n_lines[0] = rst->n_first;
+    n_lines[1] = rst->size[0] - rst->n_first;
+    winding[0] = winding[1] = 0;
 
     int32_t size_x = (int32_t) width << 6;
     int32_t size_y = (int32_t) height << 6;
@@ -779,7 +787,125 @@ bool ass_rasterizer_fill(const BitmapEngine *engine, RasterizerData *rst,
     }
     rst->size[0] = n_lines[0] + n_lines[1];
     rst->size[1] = 0;
+    return true;
+}
+
+bool ass_rasterizer_fill(const BitmapEngine *engine, RasterizerData *rst,
+                         uint8_t *buf, int x0, int y0,
+                         int width, int height, ptrdiff_t stride)
+{
+    size_t n_lines[2];
+    int winding[2];
+    if (!rasterizer_fill_prepare(engine, rst, x0, y0, width, height, n_lines, winding))
+        return false;
     return rasterizer_fill_level(engine, rst,
                                  buf, width, height, stride,
                                  0, n_lines, winding);
 }
+
+
+typedef struct {
+    size_t offs, n_lines[2];
+    int winding[2];
+    bool ok;
+} Band;
+
+typedef struct {
+    const BitmapEngine *engine;
+    const RasterizerData *rst;
+    RasterizerData *const *scratch;
+    Band *bands;
+    uint8_t *buf;
+    int width, band_height, last_height;
+    ptrdiff_t stride;
+    int n_bands;
+} BandJobs;
+
+static void fill_band_job(void *priv, int job, int thread)
+{
+    BandJobs *jobs = priv;
+    Band *band = &jobs->bands[job];
+    RasterizerData *rst = jobs->scratch[thread];
+
+    size_t n = band->n_lines[0] + band->n_lines[1];
+    rst->size[0] = rst->size[1] = 0;
+    band->ok = check_capacity(rst, 0, n);
+    if (!band->ok)
+        return;
+    memcpy(rst->linebuf[0], jobs->rst->linebuf[1] + band->offs, n * sizeof(struct segment));
+    rst->size[0] = n;
+
+    int height = job == jobs->n_bands - 1 ? jobs->last_height : jobs->band_height;
+    uint8_t *buf = jobs->buf + (ptrdiff_t) job * jobs->band_height * jobs->stride;
+    band->ok = rasterizer_fill_level(jobs->engine, rst, buf, jobs->width, height,
+                                     jobs->stride, 0, band->n_lines, band->winding);
+    rst->size[0] = rst->size[1] = 0;
+}
+
+bool ass_rasterizer_fill_bands(const BitmapEngine *engine, RasterizerData *rst,
+                               RasterizerData *const *scratch, ASS_ThreadPool *pool,
+                               uint8_t *buf, int x0, int y0,
+                               int width, int height, ptrdiff_t stride)
+{
+    int n_threads = ass_thread_pool_size(pool);
+    int tile_h = height >> engine->tile_order;
+    int n_bands = FFMIN(RASTERIZER_BANDS_PER_THREAD * n_threads, tile_h / 2);
+    if (n_bands < 2 || !ass_thread_pool_available(pool))
+        return ass_rasterizer_fill(engine, rst, buf, x0, y0, width, height, stride);
+
+    size_t n_lines[2];
+    int winding[2];
+    if (!rasterizer_fill_prepare(engine, rst, x0, y0, width, height, n_lines, winding))
+        return false;
+
+    int band_height = ((tile_h + n_bands - 1) / n_bands) << engine->tile_order;
+    n_bands = (height + band_height - 1) / band_height;
+    Band bands[RASTERIZER_BANDS_PER_THREAD * ASS_MAX_THREADS];
+
+    // cut off bands from the top, the rest of the polyline stays in linebuf[0]
+    // and the segments of the bands are appended to linebuf[1]
+    for (int i = 0; i < n_bands - 1; i++) {
+        if (!check_capacity(rst, 1, n_lines[0] + n_lines[1]))
+            return false;
+        Band *band = &bands[i];
+        band->offs = rst->size[1];
+        band->winding[0] = winding[0];
+        band->winding[1] = winding[1];
+        polyline_split_vert(rst->linebuf[0], n_lines,
+                            rst->linebuf[1] + band->offs, band->n_lines,
+                            rst->linebuf[0], n_lines,
+                            winding, (int32_t) band_height << 6);
+        rst->size[1] += band->n_lines[0] + band->n_lines[1];
+    }
+    if (!check_capacity(rst, 1, n_lines[0] + n_lines[1]))
+        return false;
+    Band *last = &bands[n_bands - 1];
+    last->offs = rst->size[1];
+    last->n_lines[0] = n_lines[0];
+    last->n_lines[1] = n_lines[1];
+    last->winding[0] = winding[0];
+    last->winding[1] = winding[1];
+    memcpy(rst->linebuf[1] + last->offs, rst->linebuf[0],
+           (n_lines[0] + n_lines[1]) * sizeof(struct segment));
+    rst->size[0] = 0;
+
+    BandJobs jobs = {
+        .engine = engine,
+        .rst = rst,
+        .scratch = scratch,
+        .bands = bands,
+        .buf = buf,
+        .width = width,
+        .band_height = band_height,
+        .last_height = height - (n_bands - 1) * band_height,
+        .stride = stride,
+        .n_bands = n_bands,
+    };
+    ass_thread_pool_run(pool, fill_band_job, &jobs, n_bands);
+    rst->size[1] = 0;
+
+    for (int i = 0; i < n_bands; i++)
+        if (!bands[i].ok)
+            return false;
+    return true;
+}
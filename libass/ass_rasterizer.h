@@ -24,6 +24,11 @@
 #include <stdbool.h>
 
 #include "ass_bitmap.h"
+#include "ass_threading.h"
+
+// number of bands per thread for ass_rasterizer_fill_bands(),
+// more bands balance the load better at a higher splitting cost
+#define RASTERIZER_BANDS_PER_THREAD 4
 
 
 enum {
@@ -80,5 +85,19 @@ bool ass_rasterizer_fill(const BitmapEngine *engine, RasterizerData *rst,
                          uint8_t *buf, int x0, int y0,
                          int width, int height, ptrdiff_t stride);
 
+/**
+ * \brief Parallel variant of ass_rasterizer_fill()
+ * Splits the window into horizontal bands that are filled by jobs
+ * of the thread pool. Falls back to ass_rasterizer_fill() if the pool
+ * would run the jobs on a single thread (see ass_thread_pool_available())
+ * or the window is too low to be split.
+ * \param scratch rasterizers used by the jobs, one for every thread of
+ * the pool; they must be distinct from rst and not in use otherwise
+ */
+bool ass_rasterizer_fill_bands(const BitmapEngine *engine, RasterizerData *rst,
+                               RasterizerData *const *scratch, ASS_ThreadPool *pool,
+                               uint8_t *buf, int x0, int y0,
+                               int width, int height, ptrdiff_t stride);
+
 
 #endif /* LIBASS_RASTERIZER_H */
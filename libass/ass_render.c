@@ -82,8 +82,10 @@ static bool render_context_init(RenderContext *state, ASS_Renderer *priv)
 
     if (!text_info_init(&state->text_info))
         return false;
+    state->text_info.arena = &state->arena;
 
-    if (!(state->shaper = ass_shaper_new(priv->cache.metrics_cache, priv->cache.face_size_metrics_cache)))
+    ASS_CacheGroup *group = priv->cache_group;
+    if (!(state->shaper = ass_shaper_new(group->metrics_cache, group->face_size_metrics_cache)))
         return false;
 
     return ass_rasterizer_init(&priv->engine, &state->rasterizer, RASTERIZER_PRECISION);
@@ -97,37 +99,178 @@ static void render_context_done(RenderContext *state)
         ass_shaper_free(state->shaper);
 
     text_info_done(&state->text_info);
+    free(state->layout_glyphs);
+    free(state->layout_drawings);
+    ass_arena_free(&state->arena);
 }
 
-ASS_Renderer *ass_renderer_init(ASS_Library *library)
+/**
+ * \brief Attribute the time since the last switch to the current stage
+ * and switch to a new one
+ * \return previous stage, to be restored after a nested stage
+ */
+static RenderStage enter_stage(RenderContext *state, RenderStage stage)
+{
+    RenderStage prev = state->stage;
+    if (state->renderer->frame_timing) {
+        int64_t now = ass_time_ns();
+        state->stage_time[prev] += now - state->stage_start;
+        state->stage_start = now;
+    }
+    state->stage = stage;
+    return prev;
+}
+
+// ass_cache_get() with the time spent attributed to the given stage
+static void *timed_cache_get(RenderContext *state, RenderStage stage,
+                             Cache *cache, void *key, void *priv)
+{
+    RenderStage prev = enter_stage(state, stage);
+    void *value = ass_cache_get(cache, key, priv);
+    enter_stage(state, prev);
+    return value;
+}
+
+static void free_workers(ASS_Renderer *priv)
+{
+    int n_workers = ass_thread_pool_size(priv->thread_pool) - 1;
+    ass_thread_pool_free(priv->thread_pool);
+    priv->thread_pool = NULL;
+
+    if (priv->worker_states) {
+        for (int i = 0; i < n_workers; i++)
+            render_context_done(&priv->worker_states[i]);
+        free(priv->worker_states);
+        priv->worker_states = NULL;
+    }
+    ass_rasterizer_done(&priv->band_rasterizer);
+    memset(&priv->band_rasterizer, 0, sizeof(priv->band_rasterizer));
+}
+
+static void cache_group_release(ASS_CacheGroup *group)
+{
+    if (!group || ass_atomic_dec(&group->ref_count))
+        return;
+
+    ass_cache_done(group->outline_cache);
+    ass_cache_done(group->face_size_metrics_cache);
+    ass_cache_done(group->metrics_cache);
+    ass_cache_done(group->font_cache);
+
+    if (group->fontselect)
+        ass_fontselect_free(group->fontselect);
+    FT_Done_FreeType(group->ftlibrary);
+    free(group->default_font);
+    free(group->default_family);
+    free(group->fonts_config);
+    free(group->fonts_dir);
+    free(group->font_index);
+
+    ass_cond_destroy(&group->idle);
+    ass_mutex_destroy(&group->lock);
+    ass_mutex_destroy(&group->font_lock);
+    free(group);
+}
+
+ASS_CacheGroup *ass_cache_group_init(ASS_Library *library)
 {
-    int error;
     FT_Library ft;
-    ASS_Renderer *priv = 0;
     int vmajor, vminor, vpatch;
 
-    ass_msg(library, MSGL_INFO, "libass API version: 0x%X", LIBASS_VERSION);
-    ass_msg(library, MSGL_INFO, "libass source: %s", CONFIG_SOURCEVERSION);
-
-    error = FT_Init_FreeType(&ft);
+    int error = FT_Init_FreeType(&ft);
     if (error) {
         ass_msg(library, MSGL_FATAL, "%s failed", "FT_Init_FreeType");
-        goto fail;
+        return NULL;
     }
 
     FT_Library_Version(ft, &vmajor, &vminor, &vpatch);
     ass_msg(library, MSGL_V, "Raster: FreeType %d.%d.%d",
            vmajor, vminor, vpatch);
 
-    priv = calloc(1, sizeof(ASS_Renderer));
-    if (!priv) {
-        FT_Done_FreeType(ft);
-        goto fail;
+    ASS_CacheGroup *group = calloc(1, sizeof(*group));
+    if (!group)
+        goto fail_ft;
+    if (!ass_mutex_init(&group->font_lock, true))
+        goto fail_alloc;
+    if (!ass_mutex_init(&group->lock, false))
+        goto fail_font_lock;
+    if (!ass_cond_init(&group->idle))
+        goto fail_lock;
+
+    group->library = library;
+    group->ftlibrary = ft;
+    group->ref_count = 1;
+
+    group->font_cache = ass_font_cache_create();
+    group->outline_cache = ass_outline_cache_create();
+    group->face_size_metrics_cache = ass_face_size_metrics_cache_create();
+    group->metrics_cache = ass_glyph_metrics_cache_create();
+    if (!group->font_cache || !group->outline_cache ||
+        !group->face_size_metrics_cache || !group->metrics_cache) {
+        cache_group_release(group);
+        return NULL;
     }
 
-    priv->library = library;
-    priv->ftlibrary = ft;
-    // images_root and related stuff is zero-filled in calloc
+    group->glyph_max = GLYPH_CACHE_MAX;
+    return group;
+
+fail_lock:
+    ass_mutex_destroy(&group->lock);
+fail_font_lock:
+    ass_mutex_destroy(&group->font_lock);
+fail_alloc:
+    free(group);
+fail_ft:
+    FT_Done_FreeType(ft);
+    return NULL;
+}
+
+void ass_cache_group_done(ASS_CacheGroup *group)
+{
+    cache_group_release(group);
+}
+
+static bool image_pool_init(ImagePool *pool, BitmapPool *buffers, unsigned align)
+{
+    pool->align = align;
+    pool->buffers = buffers;
+    return ass_mutex_init(&pool->lock, false);
+}
+
+static void image_pool_done(ImagePool *pool)
+{
+    while (pool->free_images) {
+        ASS_ImagePriv *img = pool->free_images;
+        pool->free_images = (ASS_ImagePriv *) img->result.next;
+        free(img);
+    }
+    ass_mutex_destroy(&pool->lock);
+}
+
+/**
+ * \brief Get an aligned bitmap buffer, uninitialized.
+ * \param size in: required size, out: allocated size
+ */
+static void *image_pool_get_buffer(ImagePool *pool, size_t *size)
+{
+    return ass_bitmap_pool_get(pool->buffers, pool->align, size, false);
+}
+
+static void image_pool_put_buffer(ImagePool *pool, void *buf, size_t size)
+{
+    ass_bitmap_pool_put(pool->buffers, buf, size);
+}
+
+ASS_Renderer *ass_renderer_init(ASS_Library *library)
+{
+    ASS_Renderer *priv = 0;
+
+    ass_msg(library, MSGL_INFO, "libass API version: 0x%X", LIBASS_VERSION);
+    ass_msg(library, MSGL_INFO, "libass source: %s", CONFIG_SOURCEVERSION);
+
+    priv = calloc(1, sizeof(ASS_Renderer));
+    if (!priv)
+        goto fail;
 
     unsigned flags = ASS_CPU_FLAG_ALL;
 #if CONFIG_LARGE_TILES
@@ -135,18 +278,34 @@ ASS_Renderer *ass_renderer_init(ASS_Library *library)
 #endif
     priv->engine = ass_bitmap_engine_init(flags);
 
-    priv->cache.font_cache = ass_font_cache_create();
+    unsigned align = 1 << priv->engine.align_order;
+    priv->bitmap_pool = ass_bitmap_pool_create(align, BITMAP_POOL_MAX_SIZE);
+    if (!priv->bitmap_pool) {
+        free(priv);
+        priv = NULL;
+        goto fail;
+    }
+    priv->engine.pool = priv->bitmap_pool;
+    if (!image_pool_init(&priv->image_pool, priv->bitmap_pool, align)) {
+        ass_bitmap_pool_free(priv->bitmap_pool);
+        free(priv);
+        priv = NULL;
+        goto fail;
+    }
+
+    priv->library = library;
+    priv->cache_group = ass_cache_group_init(library);
+    if (!priv->cache_group)
+        goto fail;
+    // images_root and related stuff is zero-filled in calloc
+
     priv->cache.bitmap_cache = ass_bitmap_cache_create();
     priv->cache.composite_cache = ass_composite_cache_create();
-    priv->cache.outline_cache = ass_outline_cache_create();
-    priv->cache.face_size_metrics_cache = ass_face_size_metrics_cache_create();
-    priv->cache.metrics_cache = ass_glyph_metrics_cache_create();
-    if (!priv->cache.font_cache || !priv->cache.bitmap_cache ||
-        !priv->cache.composite_cache || !priv->cache.outline_cache ||
-        !priv->cache.face_size_metrics_cache || !priv->cache.metrics_cache)
+    priv->cache.layout_cache = ass_layout_cache_create();
+    if (!priv->cache.bitmap_cache || !priv->cache.composite_cache ||
+            !priv->cache.layout_cache)
         goto fail;
 
-    priv->cache.glyph_max = GLYPH_CACHE_MAX;
     priv->cache.bitmap_max_size = BITMAP_CACHE_MAX_SIZE;
     priv->cache.composite_max_size = COMPOSITE_CACHE_MAX_SIZE;
 
@@ -180,42 +339,138 @@ void ass_renderer_done(ASS_Renderer *render_priv)
     ass_frame_unref(render_priv->images_root);
     ass_frame_unref(render_priv->prev_images_root);
 
+    free_workers(render_priv);
+
+    // bitmaps and layouts reference outlines of the group, so drop them first
     ass_cache_done(render_priv->cache.composite_cache);
     ass_cache_done(render_priv->cache.bitmap_cache);
-    ass_cache_done(render_priv->cache.outline_cache);
-    ass_cache_done(render_priv->cache.face_size_metrics_cache);
-    ass_cache_done(render_priv->cache.metrics_cache);
-    ass_cache_done(render_priv->cache.font_cache);
-
-    if (render_priv->fontselect)
-        ass_fontselect_free(render_priv->fontselect);
-    if (render_priv->ftlibrary)
-        FT_Done_FreeType(render_priv->ftlibrary);
+    ass_cache_done(render_priv->cache.layout_cache);
     free(render_priv->eimg);
+    free(render_priv->batch.events);
+    free(render_priv->batch.times);
+    free(render_priv->batch.slots);
+    free(render_priv->last_frame.events);
+    free(render_priv->damage.images);
 
     render_context_done(&render_priv->state);
+    cache_group_release(render_priv->cache_group);
 
     free(render_priv->settings.default_font);
     free(render_priv->settings.default_family);
 
     free(render_priv->user_override_style.FontName);
 
+    image_pool_done(&render_priv->image_pool);
+    ass_bitmap_pool_free(render_priv->bitmap_pool);
     free(render_priv);
 }
 
+int ass_set_threads(ASS_Renderer *priv, int threads)
+{
+    threads = FFMINMAX(threads, 1, ASS_MAX_THREADS);
+    if (threads == ass_thread_pool_size(priv->thread_pool))
+        return threads;
+
+    free_workers(priv);
+    if (threads == 1)
+        return 1;
+
+    ASS_ThreadPool *pool = ass_thread_pool_create(threads);
+    if (!pool) {
+        ass_msg(priv->library, MSGL_WARN,
+                "Multithreaded rendering is not available");
+        return 1;
+    }
+
+    int n_workers = ass_thread_pool_size(pool) - 1;
+    RenderContext *states = calloc(n_workers, sizeof(RenderContext));
+    if (!states)
+        goto fail;
+    priv->thread_pool = pool;
+    priv->worker_states = states;
+    for (int i = 0; i < n_workers; i++)
+        if (!render_context_init(&states[i], priv))
+            goto fail;
+    if (!ass_rasterizer_init(&priv->engine, &priv->band_rasterizer, RASTERIZER_PRECISION))
+        goto fail;
+
+    ass_msg(priv->library, MSGL_V, "Rendering with %d threads", n_workers + 1);
+    return n_workers + 1;
+
+fail:
+    ass_msg(priv->library, MSGL_ERR, "Failed to set up rendering threads");
+    priv->thread_pool = pool;
+    priv->worker_states = states;
+    free_workers(priv);
+    return 1;
+}
+
+int ass_set_cache_group(ASS_Renderer *priv, ASS_CacheGroup *group)
+{
+    if (group->library != priv->library) {
+        ass_msg(priv->library, MSGL_ERR,
+                "Cache group belongs to a different library");
+        return 0;
+    }
+    if (group == priv->cache_group)
+        return 1;
+
+    // shapers look up metrics in the caches of the group
+    int n_states = ass_thread_pool_size(priv->thread_pool);
+    ASS_Shaper *shapers[ASS_MAX_THREADS];
+    for (int i = 0; i < n_states; i++) {
+        shapers[i] = ass_shaper_new(group->metrics_cache,
+                                    group->face_size_metrics_cache);
+        if (!shapers[i]) {
+            while (i--)
+                ass_shaper_free(shapers[i]);
+            return 0;
+        }
+    }
+    for (int i = 0; i < n_states; i++) {
+        RenderContext *state = i ? &priv->worker_states[i - 1] : &priv->state;
+        ass_shaper_free(state->shaper);
+        state->shaper = shapers[i];
+    }
+
+    // Bitmaps and layouts keep outlines of the old group alive and can
+    // never be hit again, so release them together with the last frame.
+    ass_frame_unref(priv->images_root);
+    priv->images_root = NULL;
+    priv->last_frame.reusable = false;
+    priv->damage.prev_valid = false;
+    ass_cache_empty(priv->cache.composite_cache);
+    ass_cache_empty(priv->cache.bitmap_cache);
+    ass_cache_empty(priv->cache.layout_cache);
+
+    ass_atomic_inc(&group->ref_count);
+    cache_group_release(priv->cache_group);
+    priv->cache_group = group;
+    return 1;
+}
+
 /**
  * \brief Create a new ASS_Image
  * Parameters are the same as ASS_Image fields.
+ * \param source cache entry holding bitmap, or NULL if bitmap is a buffer
+ * of buffer_size bytes from image_pool_get_buffer(), owned by the new image
  */
-static ASS_Image *my_draw_bitmap(unsigned char *bitmap, int bitmap_w,
-                                 int bitmap_h, int stride, int dst_x,
-                                 int dst_y, uint32_t color,
-                                 CompositeHashValue *source)
+static ASS_Image *my_draw_bitmap(ImagePool *pool, unsigned char *bitmap,
+                                 int bitmap_w, int bitmap_h, int stride,
+                                 int dst_x, int dst_y, uint32_t color,
+                                 CompositeHashValue *source, size_t buffer_size)
 {
-    ASS_ImagePriv *img = malloc(sizeof(ASS_ImagePriv));
+    ass_mutex_lock(&pool->lock);
+    ASS_ImagePriv *img = pool->free_images;
+    if (img)
+        pool->free_images = (ASS_ImagePriv *) img->result.next;
+    ass_mutex_unlock(&pool->lock);
+
+    if (!img)
+        img = malloc(sizeof(ASS_ImagePriv));
     if (!img) {
         if (!source)
-            ass_aligned_free(bitmap);
+            image_pool_put_buffer(pool, bitmap, buffer_size);
         return NULL;
     }
 
@@ -230,7 +485,9 @@ static ASS_Image *my_draw_bitmap(unsigned char *bitmap, int bitmap_w,
     img->source = source;
     ass_cache_inc_ref(source);
     img->buffer = source ? NULL : bitmap;
+    img->buffer_size = source ? 0 : buffer_size;
     img->ref_count = 0;
+    img->pool = pool;
 
     return &img->result;
 }
@@ -386,9 +643,10 @@ static ASS_Image **render_glyph_i(RenderContext *state,
         // split up into left and right for karaoke, if needed
         if (lbrk > r[j].x0) {
             if (lbrk > r[j].x1) lbrk = r[j].x1;
-            img = my_draw_bitmap(bm->buffer + r[j].y0 * bm->stride + r[j].x0,
+            img = my_draw_bitmap(&render_priv->image_pool,
+                                 bm->buffer + r[j].y0 * bm->stride + r[j].x0,
                                  lbrk - r[j].x0, r[j].y1 - r[j].y0, bm->stride,
-                                 dst_x + r[j].x0, dst_y + r[j].y0, color, source);
+                                 dst_x + r[j].x0, dst_y + r[j].y0, color, source, 0);
             if (!img) break;
             img->type = type;
             *tail = img;
@@ -396,9 +654,10 @@ static ASS_Image **render_glyph_i(RenderContext *state,
         }
         if (lbrk < r[j].x1) {
             if (lbrk < r[j].x0) lbrk = r[j].x0;
-            img = my_draw_bitmap(bm->buffer + r[j].y0 * bm->stride + lbrk,
+            img = my_draw_bitmap(&render_priv->image_pool,
+                                 bm->buffer + r[j].y0 * bm->stride + lbrk,
                                  r[j].x1 - lbrk, r[j].y1 - r[j].y0, bm->stride,
-                                 dst_x + lbrk, dst_y + r[j].y0, color2, source);
+                                 dst_x + lbrk, dst_y + r[j].y0, color2, source, 0);
             if (!img) break;
             img->type = type;
             *tail = img;
@@ -473,9 +732,10 @@ render_glyph(RenderContext *state, Bitmap *bm, int dst_x, int dst_y,
     if (brk > b_x0) {           // draw left part
         if (brk > b_x1)
             brk = b_x1;
-        img = my_draw_bitmap(bm->buffer + bm->stride * b_y0 + b_x0,
+        img = my_draw_bitmap(&render_priv->image_pool,
+                             bm->buffer + bm->stride * b_y0 + b_x0,
                              brk - b_x0, b_y1 - b_y0, bm->stride,
-                             dst_x + b_x0, dst_y + b_y0, color, source);
+                             dst_x + b_x0, dst_y + b_y0, color, source, 0);
         if (!img) return tail;
         img->type = type;
         *tail = img;
@@ -484,9 +744,10 @@ render_glyph(RenderContext *state, Bitmap *bm, int dst_x, int dst_y,
     if (brk < b_x1) {           // draw right part
         if (brk < b_x0)
             brk = b_x0;
-        img = my_draw_bitmap(bm->buffer + bm->stride * b_y0 + brk,
+        img = my_draw_bitmap(&render_priv->image_pool,
+                             bm->buffer + bm->stride * b_y0 + brk,
                              b_x1 - brk, b_y1 - b_y0, bm->stride,
-                             dst_x + brk, dst_y + b_y0, color2, source);
+                             dst_x + brk, dst_y + b_y0, color2, source, 0);
         if (!img) return tail;
         img->type = type;
         *tail = img;
@@ -720,12 +981,15 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
 
     ASS_Vector pos;
     BitmapHashKey key;
-    key.outline = ass_cache_get(render_priv->cache.outline_cache, &ol_key, render_priv);
+    key.outline = timed_cache_get(state, STAGE_OUTLINE,
+                                  render_priv->cache_group->outline_cache,
+                                  &ol_key, render_priv);
     if (!key.outline || !key.outline->valid ||
             !quantize_transform(m, &pos, NULL, true, &key))
         return;
 
-    Bitmap *clip_bm = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    Bitmap *clip_bm = timed_cache_get(state, STAGE_RASTER,
+                                      render_priv->cache.bitmap_cache, &key, state);
     if (!clip_bm)
         return;
 
@@ -736,6 +1000,7 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
         int bx, by, bw, bh, bs;
         int aleft, atop, bleft, btop;
         unsigned char *abuffer, *bbuffer, *nbuffer;
+        size_t size;
 
         abuffer = cur->bitmap;
         bbuffer = clip_bm->buffer;
@@ -771,7 +1036,8 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
             }
 
             // Allocate new buffer and add to free list
-            nbuffer = ass_aligned_alloc(align, as * ah + align, false);
+            size = (size_t) as * ah + align;
+            nbuffer = image_pool_get_buffer(&render_priv->image_pool, &size);
             if (!nbuffer)
                 break;
 
@@ -790,7 +1056,8 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
 
             // Allocate new buffer and add to free list
             unsigned ns = ass_align(align, w);
-            nbuffer = ass_aligned_alloc(align, ns * h + align, false);
+            size = (size_t) ns * h + align;
+            nbuffer = image_pool_get_buffer(&render_priv->image_pool, &size);
             if (!nbuffer)
                 break;
 
@@ -808,6 +1075,7 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
 
         ASS_ImagePriv *priv = (ASS_ImagePriv *) cur;
         priv->buffer = cur->bitmap = nbuffer;
+        priv->buffer_size = size;
         ass_cache_dec_ref(priv->source);
         priv->source = NULL;
     }
@@ -1181,7 +1449,7 @@ get_outline_glyph(RenderContext *state, GlyphInfo *info)
     if (info->drawing_text.str) {
         key.type = OUTLINE_DRAWING;
         key.u.drawing.text = info->drawing_text;
-        val = ass_cache_get(priv->cache.outline_cache, &key, priv);
+        val = ass_cache_get(priv->cache_group->outline_cache, &key, priv);
         if (!val || !val->valid)
             return;
 
@@ -1203,8 +1471,9 @@ get_outline_glyph(RenderContext *state, GlyphInfo *info)
         k->bold = info->bold;
         k->italic = info->italic;
         k->flags = info->flags;
+        k->hinting = priv->settings.hinting;
 
-        val = ass_cache_get(priv->cache.outline_cache, &key, priv);
+        val = ass_cache_get(priv->cache_group->outline_cache, &key, priv);
         if (!val || !val->valid)
             return;
 
@@ -1242,16 +1511,19 @@ size_t ass_outline_construct(void *key, void *value, void *priv)
     case OUTLINE_GLYPH:
         {
             GlyphHashKey *k = &outline_key->u.glyph;
+            ass_mutex_lock(&render_priv->cache_group->font_lock);
             ass_face_set_size(k->font->faces[k->face_index], k->size);
-            if (!ass_font_get_glyph(k->font, k->face_index, k->glyph_index,
-                                    render_priv->settings.hinting))
-                return 1;
-            if (!ass_get_glyph_outline(&v->outline[0], &v->advance,
-                                       k->font->faces[k->face_index],
-                                       k->flags))
+            bool ok = ass_font_get_glyph(k->font, k->face_index, k->glyph_index,
+                                         k->hinting) &&
+                      ass_get_glyph_outline(&v->outline[0], &v->advance,
+                                            k->font->faces[k->face_index],
+                                            k->flags);
+            if (ok)
+                ass_font_get_asc_desc(k->font, k->face_index,
+                                      &v->asc, &v->desc);
+            ass_mutex_unlock(&render_priv->cache_group->font_lock);
+            if (!ok)
                 return 1;
-            ass_font_get_asc_desc(k->font, k->face_index,
-                                  &v->asc, &v->desc);
             break;
         }
     case OUTLINE_DRAWING:
@@ -1409,7 +1681,8 @@ get_bitmap_glyph(RenderContext *state, GlyphInfo *info,
     if (!quantize_transform(m, pos, offset, first, &key))
         return;
 
-    info->bm = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    info->bm = timed_cache_get(state, STAGE_RASTER,
+                               render_priv->cache.bitmap_cache, &key, state);
     if (!info->bm || !info->bm->buffer)
         info->bm = NULL;
 
@@ -1528,12 +1801,15 @@ get_bitmap_glyph(RenderContext *state, GlyphInfo *info,
         }
     }
 
-    key.outline = ass_cache_get(render_priv->cache.outline_cache, &ol_key, render_priv);
+    key.outline = timed_cache_get(state, STAGE_STROKE,
+                                  render_priv->cache_group->outline_cache,
+                                  &ol_key, render_priv);
     if (!key.outline || !key.outline->valid ||
             !quantize_transform(m, pos_o, offset, false, &key))
         return;
 
-    info->bm_o = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    info->bm_o = timed_cache_get(state, STAGE_RASTER,
+                                 render_priv->cache.bitmap_cache, &key, state);
     if (!info->bm_o || !info->bm_o->buffer) {
         info->bm_o = NULL;
         *pos_o = *pos;
@@ -2229,16 +2505,14 @@ static void preliminary_layout(RenderContext *state)
 }
 
 // Reorder text into visual order
-static void reorder_text(RenderContext *state)
+static bool reorder_text(RenderContext *state)
 {
     ASS_Renderer *render_priv = state->renderer;
     TextInfo *text_info = &state->text_info;
     FriBidiStrIndex *cmap = ass_shaper_reorder(state->shaper, text_info);
     if (!cmap) {
         ass_msg(render_priv->library, MSGL_ERR, "Failed to reorder text");
-        ass_shaper_cleanup(state->shaper, text_info);
-        free_render_context(state);
-        return;
+        return false;
     }
 
     // Reposition according to the map
@@ -2266,6 +2540,7 @@ static void reorder_text(RenderContext *state)
             info = info->next;
         }
     }
+    return true;
 }
 
 static void apply_baseline_shear(RenderContext *state)
@@ -2528,7 +2803,8 @@ static void render_and_combine_glyphs(RenderContext *state,
                 current_info->image = NULL;
 
                 current_info->bitmap_count = current_info->max_bitmap_count = 0;
-                current_info->bitmaps = malloc(MAX_SUB_BITMAPS_INITIAL * sizeof(BitmapRef));
+                current_info->bitmaps =
+                    ass_arena_alloc(&state->arena, MAX_SUB_BITMAPS_INITIAL * sizeof(BitmapRef));
                 if (!current_info->bitmaps)
                     continue;
 
@@ -2550,9 +2826,14 @@ static void render_and_combine_glyphs(RenderContext *state,
 
             if (current_info->bitmap_count >= current_info->max_bitmap_count) {
                 size_t new_size = 2 * current_info->max_bitmap_count;
-                if (!ASS_REALLOC_ARRAY(current_info->bitmaps, new_size))
+                BitmapRef *bitmaps =
+                    ass_arena_realloc_array(&state->arena, current_info->bitmaps,
+                                            current_info->max_bitmap_count,
+                                            new_size, sizeof(BitmapRef));
+                if (!bitmaps)
                     continue;
 
+                current_info->bitmaps = bitmaps;
                 current_info->max_bitmap_count = new_size;
             }
             current_info->bitmaps[current_info->bitmap_count].bm   = info->bm;
@@ -2568,10 +2849,8 @@ static void render_and_combine_glyphs(RenderContext *state,
 
     for (int i = 0; i < nb_bitmaps; i++) {
         CombinedBitmapInfo *info = &combined_info[i];
-        if (!info->bitmap_count) {
-            free(info->bitmaps);
+        if (!info->bitmap_count)
             continue;
-        }
 
         if (info->effect_type == EF_KARAOKE_KF)
             info->effect_timing = lround(d6_to_double(info->leftmost_x) +
@@ -2588,7 +2867,9 @@ static void render_and_combine_glyphs(RenderContext *state,
         key.filter = info->filter;
         key.bitmap_count = info->bitmap_count;
         key.bitmaps = info->bitmaps;
-        CompositeHashValue *val = ass_cache_get(render_priv->cache.composite_cache, &key, render_priv);
+        CompositeHashValue *val = timed_cache_get(state, STAGE_COMPOSITE,
+                                                  render_priv->cache.composite_cache,
+                                                  &key, render_priv);
         if (!val)
             continue;
 
@@ -2723,8 +3004,10 @@ size_t ass_composite_construct(void *key, void *value, void *priv)
     double r2x = restore_blur(k->filter.blur_x);
     double r2y = restore_blur(k->filter.blur_y);
     if (!(flags & FILTER_NONZERO_BORDER) || (flags & FILTER_BORDER_STYLE_3))
-        ass_synth_blur(&render_priv->engine, &v->bm, k->filter.be, r2x, r2y);
-    ass_synth_blur(&render_priv->engine, &v->bm_o, k->filter.be, r2x, r2y);
+        ass_synth_blur(&render_priv->engine, render_priv->thread_pool,
+                       &v->bm, k->filter.be, r2x, r2y);
+    ass_synth_blur(&render_priv->engine, render_priv->thread_pool,
+                   &v->bm_o, k->filter.be, r2x, r2y);
 
     if (!(flags & FILTER_FILL_IN_BORDER) && !(flags & FILTER_FILL_IN_SHADOW))
         ass_fix_outline(&v->bm, &v->bm_o);
@@ -2775,20 +3058,338 @@ static void add_background(RenderContext *state, EventImages *event_images)
     int h = bottom - top;
     if (w < 1 || h < 1)
         return;
-    void *nbuffer = ass_aligned_alloc(1, w * h, false);
+    size_t size = (size_t) w * h;
+    void *nbuffer = image_pool_get_buffer(&render_priv->image_pool, &size);
     if (!nbuffer)
         return;
     memset(nbuffer, 0xFF, w * h);
     uint32_t clr = state->c[3];
     ass_apply_fade(&clr, state->fade);
-    ASS_Image *img = my_draw_bitmap(nbuffer, w, h, w, left, top,
-                                    clr, NULL);
+    ASS_Image *img = my_draw_bitmap(&render_priv->image_pool, nbuffer,
+                                    w, h, w, left, top, clr, NULL, size);
     if (img) {
         img->next = event_images->imgs;
         event_images->imgs = img;
     }
 }
 
+/**
+ * \brief Shape, wrap and align the parsed text of the current event
+ * \param bbox out: text bounding box before baseline shear
+ */
+static bool layout_text(RenderContext *state, double max_text_width,
+                        ASS_DRect *bbox)
+{
+    ASS_Renderer *render_priv = state->renderer;
+    TextInfo *text_info = &state->text_info;
+
+    // Find shape runs and shape text
+    ass_shaper_set_base_direction(state->shaper,
+            ass_resolve_base_direction(state->font_encoding));
+    enter_stage(state, STAGE_SHAPE);
+    ass_mutex_lock(&render_priv->cache_group->font_lock);
+    ass_shaper_find_runs(state->shaper, render_priv, text_info->glyphs,
+            text_info->length);
+    bool shaped = ass_shaper_shape(state->shaper, text_info);
+    ass_mutex_unlock(&render_priv->cache_group->font_lock);
+    enter_stage(state, STAGE_OTHER);
+    if (!shaped) {
+        ass_msg(render_priv->library, MSGL_ERR, "Failed to shape text");
+        return false;
+    }
+
+    enter_stage(state, STAGE_OUTLINE);
+    retrieve_glyphs(state);
+    enter_stage(state, STAGE_OTHER);
+
+    preliminary_layout(state);
+
+    // wrap lines
+    enter_stage(state, STAGE_WRAP);
+    wrap_lines_smart(state, max_text_width);
+    enter_stage(state, STAGE_OTHER);
+
+    // depends on glyph x coordinates being monotonous within runs, so it should be done before reorder
+    ass_process_karaoke_effects(state);
+
+    if (!reorder_text(state))
+        return false;
+
+    align_lines(state, max_text_width);
+
+    // determine text bounding box
+    compute_string_bbox(text_info, bbox);
+
+    apply_baseline_shear(state);
+    return true;
+}
+
+// properties of GlyphInfo that are not read during layout
+typedef struct {
+    uint32_t c[4];
+    int fade;
+    int be;
+    double blur;
+    double shadow_x, shadow_y;
+    double frx, fry, frz;
+    double fax;
+    int border_style;
+} LayoutIndependent;
+
+static void clear_layout_independent(GlyphInfo *info)
+{
+    memset(info->c, 0, sizeof(info->c));
+    info->fade = 0;
+    info->be = 0;
+    info->blur = 0;
+    info->shadow_x = info->shadow_y = 0;
+    info->frx = info->fry = info->frz = 0;
+    info->fax = 0;
+    info->border_style = 0;
+}
+
+static void save_layout_independent(LayoutIndependent *dst,
+                                    const GlyphInfo *info)
+{
+    memcpy(dst->c, info->c, sizeof(dst->c));
+    dst->fade = info->fade;
+    dst->be = info->be;
+    dst->blur = info->blur;
+    dst->shadow_x = info->shadow_x;
+    dst->shadow_y = info->shadow_y;
+    dst->frx = info->frx;
+    dst->fry = info->fry;
+    dst->frz = info->frz;
+    dst->fax = info->fax;
+    dst->border_style = info->border_style;
+}
+
+static void restore_layout_independent(GlyphInfo *info,
+                                       const LayoutIndependent *src)
+{
+    memcpy(info->c, src->c, sizeof(info->c));
+    info->fade = src->fade;
+    info->be = src->be;
+    info->blur = src->blur;
+    info->shadow_x = src->shadow_x;
+    info->shadow_y = src->shadow_y;
+    info->frx = src->frx;
+    info->fry = src->fry;
+    info->frz = src->frz;
+    info->fax = src->fax;
+    info->border_style = src->border_style;
+}
+
+/**
+ * \brief Fill a layout cache key for the parsed text of the current event.
+ * Colors, fade, rotation, blur and shadow do not affect the layout
+ * and are left out, so that events animating them with \t still hit
+ * the cache. Only the run boundaries they cause are part of the key.
+ * \fay shears the baseline and stays in the key.
+ * \return false if the layout cannot be cached
+ */
+static bool layout_key_init(RenderContext *state, LayoutHashKey *key,
+                            double max_text_width)
+{
+    ASS_Renderer *render_priv = state->renderer;
+    TextInfo *text_info = &state->text_info;
+
+    size_t drawings_len = 0;
+    for (int i = 0; i < text_info->length; i++) {
+        const GlyphInfo *info = text_info->glyphs + i;
+        // karaoke is applied during layout and depends on the time
+        if (info->effect_type != EF_NONE)
+            return false;
+        drawings_len += info->drawing_text.len;
+    }
+
+    if (text_info->length > state->max_layout_glyphs) {
+        if (!ASS_REALLOC_ARRAY(state->layout_glyphs, text_info->length))
+            return false;
+        state->max_layout_glyphs = text_info->length;
+    }
+    if (drawings_len > state->max_layout_drawings) {
+        if (!ASS_REALLOC_ARRAY(state->layout_drawings, drawings_len))
+            return false;
+        state->max_layout_drawings = drawings_len;
+    }
+
+    char *drawings = state->layout_drawings;
+    for (int i = 0; i < text_info->length; i++) {
+        GlyphInfo *info = state->layout_glyphs + i;
+        // glyphs are zero-filled by parse_events(), so padding compares equal
+        memcpy(info, text_info->glyphs + i, sizeof(*info));
+        clear_layout_independent(info);
+        // drawings are compared by content; drawing_scale tells them apart
+        if (info->drawing_text.len) {
+            memcpy(drawings, info->drawing_text.str, info->drawing_text.len);
+            drawings += info->drawing_text.len;
+        }
+        info->drawing_text.str = NULL;
+    }
+
+    // the track fields read during layout; the others it depends on
+    // (WrapStyle, ScaledBorderAndShadow, PlayRes) enter through the state
+    ASS_Track *track = render_priv->track;
+    key->font_generation = render_priv->font_generation;
+    key->feature_flags = track->parser_priv->feature_flags;
+    key->kerning = track->Kerning;
+    key->language.str = track->Language ? track->Language : "";
+    key->language.len = strlen(key->language.str);
+    key->alignment = state->alignment;
+    key->justify = state->justify;
+    key->wrap_style = state->wrap_style;
+    key->evt_type = state->evt_type;
+    key->font_encoding = state->font_encoding;
+    key->max_text_width = max_text_width;
+    key->screen_scale_x = state->screen_scale_x;
+    key->screen_scale_y = state->screen_scale_y;
+    key->border_scale_x = state->border_scale_x;
+    key->border_scale_y = state->border_scale_y;
+    key->glyphs.str = (const char *) state->layout_glyphs;
+    key->glyphs.len = text_info->length * sizeof(GlyphInfo);
+    key->drawings.str = drawings_len ? state->layout_drawings : "";
+    key->drawings.len = drawings_len;
+    return true;
+}
+
+/**
+ * \brief Copy the laid out text of the current event into a cache value
+ */
+static bool store_layout(RenderContext *state, LayoutHashValue *v)
+{
+    TextInfo *text_info = &state->text_info;
+
+    int n_glyphs = 0;
+    size_t n_outlines = 0;
+    for (int i = 0; i < text_info->length; i++) {
+        for (GlyphInfo *info = text_info->glyphs + i; info; info = info->next) {
+            n_glyphs++;
+            if (info->outline)
+                n_outlines++;
+        }
+    }
+
+    if (!ASS_REALLOC_ARRAY(v->glyphs, n_glyphs) ||
+            !ASS_REALLOC_ARRAY(v->lines, text_info->n_lines) ||
+            !ASS_REALLOC_ARRAY(v->outlines, n_outlines))
+        return false;
+
+    GlyphInfo *cluster = v->glyphs + text_info->length;
+    for (int i = 0; i < text_info->length; i++) {
+        GlyphInfo *dst = v->glyphs + i;
+        for (GlyphInfo *info = text_info->glyphs + i; info; info = info->next) {
+            *dst = *info;
+            if (info->outline) {
+                ass_cache_inc_ref(info->outline);
+                v->outlines[v->n_outlines++] = info->outline;
+            }
+            if (info->next)
+                dst = dst->next = cluster++;
+        }
+    }
+    v->n_glyphs = text_info->length;
+
+    memcpy(v->lines, text_info->lines, text_info->n_lines * sizeof(LineInfo));
+    v->n_lines = text_info->n_lines;
+    v->height = text_info->height;
+    v->border_top = text_info->border_top;
+    v->border_bottom = text_info->border_bottom;
+    v->border_x = text_info->border_x;
+    return true;
+}
+
+/**
+ * \brief Replace the parsed text of the current event with a cached layout,
+ * keeping the properties that are not part of the cache key
+ */
+static bool restore_layout(RenderContext *state, const LayoutHashValue *v,
+                           ASS_DRect *bbox)
+{
+    TextInfo *text_info = &state->text_info;
+    assert(v->n_glyphs == text_info->length);
+
+    if (v->n_lines > text_info->max_lines) {
+        if (!ASS_REALLOC_ARRAY(text_info->lines, v->n_lines))
+            return false;
+        text_info->max_lines = v->n_lines;
+    }
+    memcpy(text_info->lines, v->lines, v->n_lines * sizeof(LineInfo));
+    text_info->n_lines = v->n_lines;
+    text_info->height = v->height;
+    text_info->border_top = v->border_top;
+    text_info->border_bottom = v->border_bottom;
+    text_info->border_x = v->border_x;
+    *bbox = v->bbox;
+
+    for (int i = 0; i < text_info->length; i++) {
+        GlyphInfo *info = text_info->glyphs + i;
+        LayoutIndependent props;
+        save_layout_independent(&props, info);
+        ASS_StringView drawing_text = info->drawing_text;
+
+        // cluster continuations live in the frame's arena
+        const GlyphInfo *src = v->glyphs + i;
+        while (true) {
+            *info = *src;
+            restore_layout_independent(info, &props);
+            info->drawing_text = drawing_text;
+            if (!src->next)
+                break;
+            if (!(info->next = ass_arena_alloc(&state->arena, sizeof(GlyphInfo))))
+                return false;
+            info = info->next;
+            src = src->next;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    RenderContext *state;
+    bool constructed;   // state was laid out by ass_layout_construct()
+    bool success;
+} LayoutRequest;
+
+size_t ass_layout_construct(void *key, void *value, void *priv)
+{
+    LayoutHashKey *k = key;
+    LayoutHashValue *v = value;
+    LayoutRequest *request = priv;
+    memset(v, 0, sizeof(*v));
+
+    request->constructed = true;
+    request->success = layout_text(request->state, k->max_text_width, &v->bbox);
+    if (request->success)
+        v->valid = store_layout(request->state, v);
+    return 1;
+}
+
+/**
+ * \brief Lay out the parsed text of the current event, reusing the layout
+ * of an earlier frame if only time-dependent properties have changed
+ * \param bbox out: text bounding box before baseline shear
+ */
+static bool layout_event(RenderContext *state, double max_text_width,
+                         ASS_DRect *bbox)
+{
+    LayoutHashKey key;
+    if (!layout_key_init(state, &key, max_text_width))
+        return layout_text(state, max_text_width, bbox);
+
+    LayoutRequest request = { .state = state };
+    LayoutHashValue *val =
+        ass_cache_get(state->renderer->cache.layout_cache, &key, &request);
+    if (request.constructed) {
+        if (request.success)
+            *bbox = val->bbox;
+        return request.success;
+    }
+    if (!val || !val->valid)
+        return layout_text(state, max_text_width, bbox);
+    return restore_layout(state, val, bbox);
+}
+
 /**
  * \brief Main ass rendering function, glues everything together
  * \param event event to render
@@ -2812,8 +3413,10 @@ ass_render_event(RenderContext *state, ASS_Event *event,
     free_render_context(state);
     init_render_context(state, event);
 
+    enter_stage(state, STAGE_PARSE);
     if (!parse_events(state, event))
         return false;
+    enter_stage(state, STAGE_OTHER);
 
     TextInfo *text_info = &state->text_info;
     if (text_info->length == 0) {
@@ -2824,21 +3427,6 @@ ass_render_event(RenderContext *state, ASS_Event *event,
 
     split_style_runs(state);
 
-    // Find shape runs and shape text
-    ass_shaper_set_base_direction(state->shaper,
-            ass_resolve_base_direction(state->font_encoding));
-    ass_shaper_find_runs(state->shaper, render_priv, text_info->glyphs,
-            text_info->length);
-    if (!ass_shaper_shape(state->shaper, text_info)) {
-        ass_msg(render_priv->library, MSGL_ERR, "Failed to shape text");
-        free_render_context(state);
-        return false;
-    }
-
-    retrieve_glyphs(state);
-
-    preliminary_layout(state);
-
     int valign = state->alignment & 12;
 
     int MarginL =
@@ -2853,21 +3441,11 @@ ass_render_event(RenderContext *state, ASS_Event *event,
         x2scr_right(state, render_priv->track->PlayResX - MarginR) -
         x2scr_left(state, MarginL);
 
-    // wrap lines
-    wrap_lines_smart(state, max_text_width);
-
-    // depends on glyph x coordinates being monotonous within runs, so it should be done before reorder
-    ass_process_karaoke_effects(state);
-
-    reorder_text(state);
-
-    align_lines(state, max_text_width);
-
-    // determine text bounding box
     ASS_DRect bbox;
-    compute_string_bbox(text_info, &bbox);
-
-    apply_baseline_shear(state);
+    if (!layout_event(state, max_text_width, &bbox)) {
+        free_render_context(state);
+        return false;
+    }
 
     // determine device coordinates for text
     double device_x = 0;
@@ -3004,12 +3582,13 @@ ass_render_event(RenderContext *state, ASS_Event *event,
     event_images->detect_collisions = state->detect_collisions;
     event_images->shift_direction = (valign == VALIGN_SUB) ? -1 : 1;
     event_images->event = event;
+    enter_stage(state, STAGE_RENDER_TEXT);
     event_images->imgs = render_text(state);
+    enter_stage(state, STAGE_OTHER);
 
     if (state->border_style == 4)
         add_background(state, event_images);
 
-    ass_shaper_cleanup(state->shaper, text_info);
     free_render_context(state);
 
     return true;
@@ -3022,10 +3601,59 @@ static void check_cache_limits(ASS_Renderer *priv, CacheStore *cache)
 {
     ass_cache_cut(cache->composite_cache, cache->composite_max_size);
     ass_cache_cut(cache->bitmap_cache, cache->bitmap_max_size);
-    ass_cache_cut(cache->outline_cache, cache->glyph_max);
+    ass_cache_cut(cache->layout_cache, LAYOUT_CACHE_MAX_SIZE);
 }
 
-static void setup_shaper(ASS_Shaper *shaper, ASS_Renderer *render_priv)
+/**
+ * \brief Register a frame in progress with the cache group
+ * Outlines are used without references while an event is rendered,
+ * so the shared outline cache may only be cut while no member of the group
+ * is inside a frame. If it overflows while other frames are in progress,
+ * new frames are held back until they finish. Outlines still referenced by
+ * bitmaps cannot be cut, so such a wait is only done once the cache has grown
+ * noticeably since the last cut.
+ */
+static unsigned cache_group_begin_frame(ASS_CacheGroup *group)
+{
+    ass_mutex_lock(&group->lock);
+
+    bool cut = !group->active_frames;
+    if (!cut) {
+        size_t size = ass_cache_size(group->outline_cache);
+        cut = size > group->glyph_max &&
+              size > group->cut_size + group->glyph_max / 16;
+    }
+    if (cut) {
+        while (group->active_frames)
+            ass_cond_wait(&group->idle, &group->lock);
+        ass_cache_cut(group->outline_cache, group->glyph_max);
+        group->cut_size = ass_cache_size(group->outline_cache);
+    }
+
+    if (group->library->num_fontdata != group->num_emfonts) {
+        assert(group->library->num_fontdata > group->num_emfonts);
+        ass_mutex_lock(&group->font_lock);
+        group->num_emfonts = ass_update_embedded_fonts(
+            group->fontselect, group->num_emfonts);
+        group->font_generation++;
+        ass_mutex_unlock(&group->font_lock);
+    }
+
+    unsigned font_generation = group->font_generation;
+    group->active_frames++;
+    ass_mutex_unlock(&group->lock);
+    return font_generation;
+}
+
+static void cache_group_end_frame(ASS_CacheGroup *group)
+{
+    ass_mutex_lock(&group->lock);
+    if (!--group->active_frames)
+        ass_cond_broadcast(&group->idle);
+    ass_mutex_unlock(&group->lock);
+}
+
+static void setup_shaper(ASS_Shaper *shaper, ASS_Renderer *render_priv)
 {
     ASS_Track *track = render_priv->track;
 
@@ -3040,18 +3668,117 @@ static void setup_shaper(ASS_Shaper *shaper, ASS_Renderer *render_priv)
             track->parser_priv->feature_flags & FEATURE_MASK(ASS_FEATURE_WHOLE_TEXT_LAYOUT));
 }
 
+// Events to render, each into the slot of renderer->eimg given by the job
+// number or by slots. All belong to one frame at time, unless times is set.
+typedef struct {
+    ASS_Renderer *renderer;
+    const int *events;          // event of each slot
+    long long time;
+    const long long *times;     // frame time of each slot, or NULL
+    const int *slots;           // slot of each job, or NULL
+} RenderJobs;
+
+static void render_event_job(void *priv, int job, int thread)
+{
+    RenderJobs *jobs = priv;
+    ASS_Renderer *render_priv = jobs->renderer;
+    RenderContext *state = thread ? &render_priv->worker_states[thread - 1]
+                                  : &render_priv->state;
+    int slot = jobs->slots ? jobs->slots[job] : job;
+    ASS_Event *event = render_priv->track->events + jobs->events[slot];
+    EventImages *event_images = render_priv->eimg + slot;
+
+    state->stage = STAGE_OTHER;
+    if (render_priv->frame_timing)
+        state->stage_start = ass_time_ns();
+    state->time = jobs->times ? jobs->times[slot] : jobs->time;
+    state->animated = false;
+    if (!ass_render_event(state, event, event_images))
+        event_images->event = NULL;
+    event_images->animated = state->animated;
+    // account for the stage of an early return
+    enter_stage(state, STAGE_OTHER);
+}
+
+/**
+ * \brief Check whether the last frame can be returned unchanged
+ * \param events active events of the new frame, ascending
+ */
+static bool last_frame_valid(ASS_Renderer *priv, ASS_Track *track,
+                             const int *events, int n_events)
+{
+    ASS_ParserPriv *track_priv = track->parser_priv;
+    return priv->last_frame.reusable &&
+        priv->last_frame.track_id == track_priv->track_id &&
+        priv->last_frame.track_generation == track_priv->generation &&
+        priv->last_frame.font_generation == priv->font_generation &&
+        priv->last_frame.n_events == n_events &&
+        (!n_events ||
+         !memcmp(priv->last_frame.events, events, n_events * sizeof(int)));
+}
+
+static void remember_frame(ASS_Renderer *priv, ASS_Track *track,
+                           const int *events, int n_events, bool animated)
+{
+    priv->last_frame.reusable = false;
+    if (animated)
+        return;
+    if (n_events > priv->last_frame.max_events) {
+        if (!ASS_REALLOC_ARRAY(priv->last_frame.events, n_events))
+            return;
+        priv->last_frame.max_events = n_events;
+    }
+    if (n_events)
+        memcpy(priv->last_frame.events, events, n_events * sizeof(int));
+    priv->last_frame.n_events = n_events;
+    priv->last_frame.track_id = track->parser_priv->track_id;
+    priv->last_frame.track_generation = track->parser_priv->generation;
+    priv->last_frame.font_generation = priv->font_generation;
+    priv->last_frame.reusable = true;
+}
+
+static void reset_frame_timings(ASS_Renderer *priv)
+{
+    int n_states = ass_thread_pool_size(priv->thread_pool);
+    for (int i = 0; i < n_states; i++) {
+        RenderContext *state = i ? &priv->worker_states[i - 1] : &priv->state;
+        memset(state->stage_time, 0, sizeof(state->stage_time));
+    }
+}
+
+static void collect_frame_timings(ASS_Renderer *priv, int64_t start)
+{
+    int64_t total[STAGE_COUNT] = {0};
+    int n_states = ass_thread_pool_size(priv->thread_pool);
+    for (int i = 0; i < n_states; i++) {
+        RenderContext *state = i ? &priv->worker_states[i - 1] : &priv->state;
+        for (int j = 0; j < STAGE_COUNT; j++)
+            total[j] += state->stage_time[j];
+    }
+
+    ASS_FrameTimings *timings = &priv->timings;
+    timings->total = ass_time_ns() - start;
+    timings->parse = total[STAGE_PARSE];
+    timings->shape = total[STAGE_SHAPE];
+    timings->wrap = total[STAGE_WRAP];
+    timings->outline = total[STAGE_OUTLINE];
+    timings->stroke = total[STAGE_STROKE];
+    timings->raster = total[STAGE_RASTER];
+    timings->composite = total[STAGE_COMPOSITE];
+    timings->render_text = total[STAGE_RENDER_TEXT];
+}
+
 /**
  * \brief Start a new frame
  */
 static bool
-ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
-                long long now)
+ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track)
 {
     if (!render_priv->settings.frame_width
         && !render_priv->settings.frame_height)
         return false;               // library not initialized
 
-    if (!render_priv->fontselect)
+    if (!render_priv->cache_group->fontselect)
         return false;
 
     if (render_priv->library != track->library)
@@ -3061,17 +3788,16 @@ ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
         return false;               // nothing to do
 
     render_priv->track = track;
-    render_priv->time = now;
 
     ass_lazy_track_init(render_priv->library, render_priv->track);
 
-    if (render_priv->library->num_fontdata != render_priv->num_emfonts) {
-        assert(render_priv->library->num_fontdata > render_priv->num_emfonts);
-        render_priv->num_emfonts = ass_update_embedded_fonts(
-            render_priv->fontselect, render_priv->num_emfonts);
-    }
-
     setup_shaper(render_priv->state.shaper, render_priv);
+    ass_arena_reset(&render_priv->state.arena);
+    int n_workers = ass_thread_pool_size(render_priv->thread_pool) - 1;
+    for (int i = 0; i < n_workers; i++) {
+        setup_shaper(render_priv->worker_states[i].shaper, render_priv);
+        ass_arena_reset(&render_priv->worker_states[i].arena);
+    }
 
     // PAR correction
     double par = render_priv->settings.par;
@@ -3093,6 +3819,8 @@ ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
     render_priv->images_root = NULL;
 
     check_cache_limits(render_priv, &render_priv->cache);
+    render_priv->font_generation =
+        cache_group_begin_frame(render_priv->cache_group);
 
     return true;
 }
@@ -3339,6 +4067,136 @@ static int ass_detect_change(ASS_Renderer *priv)
     return diff;
 }
 
+static void damage_full_frame(ASS_Renderer *priv)
+{
+    int width = priv->settings.frame_width;
+    int height = priv->settings.frame_height;
+    priv->damage.n_rects = 0;
+    if (width > 0 && height > 0) {
+        priv->damage.rects[0] = (ASS_DamageRect) { 0, 0, width, height };
+        priv->damage.n_rects = 1;
+    }
+}
+
+static inline ASS_DamageRect damage_union(ASS_DamageRect a, ASS_DamageRect b)
+{
+    return (ASS_DamageRect) {
+        FFMIN(a.x_min, b.x_min), FFMIN(a.y_min, b.y_min),
+        FFMAX(a.x_max, b.x_max), FFMAX(a.y_max, b.y_max)
+    };
+}
+
+static inline int64_t damage_area(ASS_DamageRect r)
+{
+    return (int64_t) (r.x_max - r.x_min) * (r.y_max - r.y_min);
+}
+
+/**
+ * \brief Add an area to the damage list, keeping the rectangles disjoint.
+ * Rectangles that overlap or touch are merged; beyond MAX_DAMAGE_RECTS,
+ * the area is merged into the rectangle that grows least.
+ */
+static void add_damage(ASS_Renderer *priv, ASS_DamageRect r)
+{
+    r.x_min = FFMAX(r.x_min, 0);
+    r.y_min = FFMAX(r.y_min, 0);
+    r.x_max = FFMIN(r.x_max, priv->settings.frame_width);
+    r.y_max = FFMIN(r.y_max, priv->settings.frame_height);
+    if (r.x_min >= r.x_max || r.y_min >= r.y_max)
+        return;
+
+    ASS_DamageRect *rects = priv->damage.rects;
+    int n = priv->damage.n_rects;
+    while (true) {
+        int i;
+        for (i = 0; i < n; i++)
+            if (rects[i].x_min <= r.x_max && r.x_min <= rects[i].x_max &&
+                    rects[i].y_min <= r.y_max && r.y_min <= rects[i].y_max)
+                break;
+        if (i == n && n < MAX_DAMAGE_RECTS)
+            break;
+
+        if (i == n) {
+            int64_t best = INT64_MAX;
+            for (int j = 0; j < n; j++) {
+                int64_t growth = damage_area(damage_union(rects[j], r)) -
+                                 damage_area(rects[j]);
+                if (growth < best) {
+                    best = growth;
+                    i = j;
+                }
+            }
+        }
+        // the union can reach other rectangles, so check again
+        r = damage_union(rects[i], r);
+        rects[i] = rects[--n];
+    }
+    rects[n++] = r;
+    priv->damage.n_rects = n;
+}
+
+static void add_image_damage(ASS_Renderer *priv, const ASS_Image *img)
+{
+    add_damage(priv, (ASS_DamageRect) {
+        img->dst_x, img->dst_y, img->dst_x + img->w, img->dst_y + img->h
+    });
+}
+
+/**
+ * \brief Find the areas that differ between the previous and current image
+ * list. Images that match at the start and at the end of both lists are
+ * blended identically, so only the differing middle parts are damaged.
+ */
+static void ass_detect_damage(ASS_Renderer *priv)
+{
+    priv->damage.n_rects = 0;
+    if (!priv->damage.prev_valid) {
+        damage_full_frame(priv);
+        return;
+    }
+
+    ASS_Image *img = priv->prev_images_root;
+    ASS_Image *img2 = priv->images_root;
+    while (img && img2 && !ass_image_compare(img, img2)) {
+        img = img->next;
+        img2 = img2->next;
+    }
+
+    size_t n = 0, n2 = 0;
+    for (ASS_Image *cur = img; cur; cur = cur->next)
+        n++;
+    for (ASS_Image *cur = img2; cur; cur = cur->next)
+        n2++;
+    if (n + n2 > priv->damage.max_images) {
+        if (!ASS_REALLOC_ARRAY(priv->damage.images, n + n2)) {
+            damage_full_frame(priv);
+            return;
+        }
+        priv->damage.max_images = n + n2;
+    }
+
+    ASS_Image **imgs = priv->damage.images, **imgs2 = imgs + n;
+    for (size_t i = 0; i < n; i++, img = img->next)
+        imgs[i] = img;
+    for (size_t i = 0; i < n2; i++, img2 = img2->next)
+        imgs2[i] = img2;
+    while (n && n2 && !ass_image_compare(imgs[n - 1], imgs2[n2 - 1])) {
+        n--;
+        n2--;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        add_image_damage(priv, imgs[i]);
+    for (size_t i = 0; i < n2; i++)
+        add_image_damage(priv, imgs2[i]);
+}
+
+int ass_get_damage(ASS_Renderer *priv, const ASS_DamageRect **rects)
+{
+    *rects = priv->damage.rects;
+    return priv->damage.n_rects;
+}
+
 /**
  * \brief free a single image.
  * \param img image as returned by ass_render_frame().
@@ -3351,13 +4209,104 @@ static ASS_Image *ass_free_image(ASS_Image *img) {
     ASS_Image *next = img->next;
 
     ASS_ImagePriv *priv = (ASS_ImagePriv *) img;
+    ImagePool *pool = priv->pool;
     ass_cache_dec_ref(priv->source);
-    ass_aligned_free(priv->buffer);
-    free(priv);
+
+    image_pool_put_buffer(pool, priv->buffer, priv->buffer_size);
+    ass_mutex_lock(&pool->lock);
+    priv->result.next = (ASS_Image *) pool->free_images;
+    pool->free_images = priv;
+    ass_mutex_unlock(&pool->lock);
 
     return next;
 }
 
+/**
+ * \brief Copy a run of images into one image covering their bounding box.
+ * The images must be disjoint, so the copies do not interfere.
+ * \return the merged image, or NULL on allocation failure
+ */
+static ASS_Image *merge_image_run(ASS_Image *first, ASS_Image *end,
+                                  int x0, int y0, int x1, int y1)
+{
+    ImagePool *pool = ((ASS_ImagePriv *) first)->pool;
+    int w = x1 - x0, h = y1 - y0;
+    size_t size = (size_t) w * h;
+    uint8_t *buffer = image_pool_get_buffer(pool, &size);
+    if (!buffer)
+        return NULL;
+    memset(buffer, 0, (size_t) w * h);
+    for (ASS_Image *img = first; img != end; img = img->next) {
+        uint8_t *dst = buffer + (img->dst_y - y0) * w + (img->dst_x - x0);
+        const uint8_t *src = img->bitmap;
+        for (int y = 0; y < img->h; y++) {
+            memcpy(dst, src, img->w);
+            dst += w;
+            src += img->stride;
+        }
+    }
+
+    ASS_Image *merged = my_draw_bitmap(pool, buffer, w, h, w, x0, y0,
+                                       first->color, NULL, size);
+    if (merged)
+        merged->type = first->type;
+    return merged;
+}
+
+/**
+ * \brief Merge runs of consecutive images that share a color and touch
+ * without overlapping, like the parts of a glyph split by inverse clips
+ * or karaoke. Runs are only extended while the bounding box stays at most
+ * twice as large as the area of the images, to avoid sparse bitmaps.
+ * \param head start of the list, which is modified in place
+ * \return pointer to the next field of the last image
+ */
+static ASS_Image **merge_images(ASS_Image **head)
+{
+    ASS_Image **tail = head;
+    ASS_Image *img;
+    while ((img = *tail)) {
+        int x0 = img->dst_x, x1 = img->dst_x + img->w;
+        int y0 = img->dst_y, y1 = img->dst_y + img->h;
+        int64_t area = (int64_t) img->w * img->h;
+        int n = 1;
+
+        ASS_Image *end = img->next;
+        for (; end && end->color == img->color; end = end->next, n++) {
+            int ex0 = end->dst_x, ex1 = end->dst_x + end->w;
+            int ey0 = end->dst_y, ey1 = end->dst_y + end->h;
+            bool touch = ex0 <= x1 && x0 <= ex1 && ey0 <= y1 && y0 <= ey1;
+            bool overlap = ex0 < x1 && x0 < ex1 && ey0 < y1 && y0 < ey1;
+            if (!touch || overlap)
+                break;
+
+            int ux0 = FFMIN(x0, ex0), ux1 = FFMAX(x1, ex1);
+            int uy0 = FFMIN(y0, ey0), uy1 = FFMAX(y1, ey1);
+            int64_t new_area = area + (int64_t) end->w * end->h;
+            if ((int64_t) (ux1 - ux0) * (uy1 - uy0) > 2 * new_area)
+                break;
+            x0 = ux0;
+            x1 = ux1;
+            y0 = uy0;
+            y1 = uy1;
+            area = new_area;
+        }
+
+        ASS_Image *merged = n > 1 ?
+            merge_image_run(img, end, x0, y0, x1, y1) : NULL;
+        if (!merged) {
+            tail = &img->next;
+            continue;
+        }
+        while (img != end)
+            img = ass_free_image(img);
+        merged->next = end;
+        *tail = merged;
+        tail = &merged->next;
+    }
+    return tail;
+}
+
 /**
  * \brief render a frame
  * \param priv library handle
@@ -3367,51 +4316,67 @@ static ASS_Image *ass_free_image(ASS_Image *img) {
  *        0 if identical, 1 if different positions, 2 if different content.
  *        Can be NULL, in that case no detection is performed.
  */
-ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
-                            long long now, int *detect_change)
+/**
+ * \brief Return the previous image list again for an unchanged frame
+ */
+static void reuse_last_frame(ASS_Renderer *priv, int *detect_change)
 {
-    // init frame
-    if (!ass_start_frame(priv, track, now)) {
-        if (detect_change)
-            *detect_change = 2;
-        return NULL;
+    priv->images_root = priv->prev_images_root;
+    priv->prev_images_root = NULL;
+    // same damage as from rendering the frame anew
+    if (detect_change) {
+        *detect_change = 0;
+        priv->damage.n_rects = 0;
+    } else {
+        damage_full_frame(priv);
     }
+    priv->damage.prev_valid = true;
+}
 
-    // render events separately
+/**
+ * \brief Build the image list of a frame from its rendered events
+ * \param events active events of the frame, ascending
+ * \param eimg rendered events, in the order of events
+ */
+static void compose_frame(ASS_Renderer *priv, ASS_Track *track,
+                          const int *events, int n_events,
+                          EventImages *eimg, int *detect_change)
+{
+    // drop events that produced no output
     int cnt = 0;
-    for (int i = 0; i < track->n_events; i++) {
-        ASS_Event *event = track->events + i;
-        if ((event->Start <= now)
-            && (now < (event->Start + event->Duration))) {
-            if (cnt >= priv->eimg_size) {
-                priv->eimg_size += 100;
-                priv->eimg =
-                    realloc(priv->eimg,
-                            priv->eimg_size * sizeof(EventImages));
-            }
-            if (ass_render_event(&priv->state, event, priv->eimg + cnt))
-                cnt++;
-        }
+    bool animated = false;
+    for (int i = 0; i < n_events; i++) {
+        animated |= eimg[i].animated;
+        if (eimg[i].event)
+            eimg[cnt++] = eimg[i];
     }
+    remember_frame(priv, track, events, n_events, animated);
 
     // sort by layer
     if (cnt > 0)
-        qsort(priv->eimg, cnt, sizeof(EventImages), cmp_event_layer);
+        qsort(eimg, cnt, sizeof(EventImages), cmp_event_layer);
 
     // call fix_collisions for each group of events with the same layer
-    EventImages *last = priv->eimg;
+    EventImages *last = eimg;
     for (int i = 1; i < cnt; i++)
-        if (last->event->Layer != priv->eimg[i].event->Layer) {
-            fix_collisions(priv, last, priv->eimg + i - last);
-            last = priv->eimg + i;
+        if (last->event->Layer != eimg[i].event->Layer) {
+            fix_collisions(priv, last, eimg + i - last);
+            last = eimg + i;
         }
     if (cnt > 0)
-        fix_collisions(priv, last, priv->eimg + cnt - last);
+        fix_collisions(priv, last, eimg + cnt - last);
 
     // concat lists, removing fully transparent bitmaps
-    ASS_Image **tail = &priv->images_root;
+    // and merging fragments within each layer if requested
+    ASS_Image **tail = &priv->images_root, **layer_start = tail;
     for (int i = 0; i < cnt; i++) {
-        ASS_Image *cur = priv->eimg[i].imgs;
+        if (priv->merge_images && i &&
+                eimg[i].event->Layer != eimg[i - 1].event->Layer) {
+            *tail = NULL;
+            tail = layer_start = merge_images(layer_start);
+        }
+
+        ASS_Image *cur = eimg[i].imgs;
         while (cur) {
             if (_a(cur->color) == 0xFF) {
                 cur = ass_free_image(cur);
@@ -3426,22 +4391,574 @@ ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
 
     // If the last image was skipped in the above loop, *tail may not be NULL and needs to be set to NULL.
     *tail = NULL;
+    if (priv->merge_images)
+        merge_images(layer_start);
 
     ass_frame_ref(priv->images_root);
 
-    if (detect_change)
+    if (detect_change) {
         *detect_change = ass_detect_change(priv);
+        if (*detect_change)
+            ass_detect_damage(priv);
+        else
+            priv->damage.n_rects = 0;
+    } else {
+        damage_full_frame(priv);
+    }
+    priv->damage.prev_valid = true;
 
     // free the previous image list
     ass_frame_unref(priv->prev_images_root);
     priv->prev_images_root = NULL;
+}
+
+/**
+ * \brief Handle a frame that cannot be rendered
+ */
+static void fail_frame(ASS_Renderer *priv, int *detect_change)
+{
+    priv->last_frame.reusable = false;
+    priv->damage.prev_valid = false;
+    damage_full_frame(priv);
+    if (detect_change)
+        *detect_change = 2;
+}
+
+ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
+                            long long now, int *detect_change)
+{
+    int64_t start = 0;
+    if (priv->frame_timing) {
+        start = ass_time_ns();
+        reset_frame_timings(priv);
+    }
+
+    // init frame
+    if (!ass_start_frame(priv, track)) {
+        fail_frame(priv, detect_change);
+        if (priv->frame_timing)
+            collect_frame_timings(priv, start);
+        return NULL;
+    }
+
+    int *active;
+    int n_active = ass_find_active_events(track, now, &active);
+    if (last_frame_valid(priv, track, active, n_active)) {
+        cache_group_end_frame(priv->cache_group);
+        reuse_last_frame(priv, detect_change);
+        goto done;
+    }
 
+    // render events separately
+    if (n_active > priv->eimg_size) {
+        int new_size = FFMAX(n_active, priv->eimg_size + 100);
+        if (ASS_REALLOC_ARRAY(priv->eimg, new_size))
+            priv->eimg_size = new_size;
+        else
+            n_active = priv->eimg_size;
+    }
+    RenderJobs jobs = { .renderer = priv, .events = active, .time = now };
+    ass_thread_pool_run(priv->thread_pool, render_event_job, &jobs, n_active);
+    cache_group_end_frame(priv->cache_group);
+
+    compose_frame(priv, track, active, n_active, priv->eimg, detect_change);
+
+done:
     if (track->parser_priv->prune_delay >= 0)
         ass_prune_events(track, now - track->parser_priv->prune_delay);
 
+    if (priv->frame_timing)
+        collect_frame_timings(priv, start);
+
     return priv->images_root;
 }
 
+#define COMPOSITE_BAND_HEIGHT 64
+
+typedef struct {
+    const BitmapEngine *engine;
+    const ASS_Image *images;
+    uint8_t *buf;
+    ptrdiff_t stride;
+    int width, height;
+} CompositeJobs;
+
+// Clear and composite one horizontal band of the frame
+static void composite_band_job(void *priv, int job, int thread)
+{
+    CompositeJobs *jobs = priv;
+    int y0 = job * COMPOSITE_BAND_HEIGHT;
+    int y1 = FFMIN(y0 + COMPOSITE_BAND_HEIGHT, jobs->height);
+
+    for (int y = y0; y < y1; y++)
+        memset(jobs->buf + y * jobs->stride, 0, 4 * (size_t) jobs->width);
+
+    for (const ASS_Image *img = jobs->images; img; img = img->next) {
+        int top = FFMAX(img->dst_y, y0);
+        int bottom = FFMIN(img->dst_y + img->h, y1);
+        if (top >= bottom || img->w <= 0)
+            continue;
+        jobs->engine->blend_rgba(
+            jobs->buf + top * jobs->stride + 4 * img->dst_x, jobs->stride,
+            img->bitmap + (top - img->dst_y) * img->stride, img->stride,
+            img->w, bottom - top, img->color);
+    }
+}
+
+int ass_render_frame_rgba(ASS_Renderer *priv, ASS_Track *track,
+                          long long now, uint8_t *buf, int stride,
+                          int *detect_change)
+{
+    int width = priv->settings.frame_width;
+    int height = priv->settings.frame_height;
+    if (!width || !height || stride / 4 < width) {
+        if (detect_change)
+            *detect_change = 2;
+        return 0;
+    }
+
+    CompositeJobs jobs = {
+        .engine = &priv->engine,
+        .images = ass_render_frame(priv, track, now, detect_change),
+        .buf = buf,
+        .stride = stride,
+        .width = width,
+        .height = height,
+    };
+    int n_bands = (height + COMPOSITE_BAND_HEIGHT - 1) / COMPOSITE_BAND_HEIGHT;
+    ass_thread_pool_run(priv->thread_pool, composite_band_job, &jobs, n_bands);
+    return 1;
+}
+
+#define YUV_BAND_HEIGHT 64
+
+// RGB to YCbCr conversion, see ASS_YCbCrMatrix
+typedef struct {
+    double kr, kb;
+    bool full_range;
+} YUVMatrix;
+
+static bool get_yuv_matrix(YUVMatrix *m, ASS_YCbCrMatrix matrix)
+{
+    switch (matrix) {
+    case YCBCR_BT601_TV:
+    case YCBCR_BT601_PC:
+        m->kr = 0.299;
+        m->kb = 0.114;
+        break;
+    case YCBCR_BT709_TV:
+    case YCBCR_BT709_PC:
+        m->kr = 0.2126;
+        m->kb = 0.0722;
+        break;
+    case YCBCR_SMPTE240M_TV:
+    case YCBCR_SMPTE240M_PC:
+        m->kr = 0.212;
+        m->kb = 0.087;
+        break;
+    case YCBCR_FCC_TV:
+    case YCBCR_FCC_PC:
+        m->kr = 0.30;
+        m->kb = 0.11;
+        break;
+    default:
+        return false;
+    }
+    m->full_range = matrix == YCBCR_BT601_PC || matrix == YCBCR_BT709_PC ||
+                    matrix == YCBCR_SMPTE240M_PC || matrix == YCBCR_FCC_PC;
+    return true;
+}
+
+// the matrix VSFilter would use to convert the colors of the track
+static ASS_YCbCrMatrix subtitle_matrix(const ASS_Track *track,
+                                       ASS_YCbCrMatrix video)
+{
+    switch (track->YCbCrMatrix) {
+    case YCBCR_NONE:
+        return video;
+    case YCBCR_DEFAULT:
+    case YCBCR_UNKNOWN:
+        return YCBCR_BT601_TV;
+    default:
+        return track->YCbCrMatrix;
+    }
+}
+
+static void color_to_yuv(const YUVMatrix *m, uint32_t color, int depth,
+                         unsigned yuv[3])
+{
+    double r = (color >> 24) / 255.0;
+    double g = ((color >> 16) & 0xFF) / 255.0;
+    double b = ((color >> 8) & 0xFF) / 255.0;
+    double y = m->kr * r + (1 - m->kr - m->kb) * g + m->kb * b;
+    double pb = (b - y) / (2 * (1 - m->kb));
+    double pr = (r - y) / (2 * (1 - m->kr));
+
+    double max = (1 << depth) - 1;
+    double val[3];
+    if (m->full_range) {
+        double mid = 1 << (depth - 1);
+        val[0] = y * max;
+        val[1] = mid + pb * max;
+        val[2] = mid + pr * max;
+    } else {
+        // TV range levels scale with the bit depth
+        double scale = 1 << (depth - 8);
+        val[0] = (16 + 219 * y) * scale;
+        val[1] = (128 + 224 * pb) * scale;
+        val[2] = (128 + 224 * pr) * scale;
+    }
+    for (int i = 0; i < 3; i++)
+        yuv[i] = ass_lrint(FFMINMAX(val[i], 0, max));
+}
+
+// Average the coverage of img over the chroma samples
+// [cx0, cx0 + cw) x [cy0, cy1), with partly covered samples
+// counting the missing pixels as transparent
+static void subsample_mask(uint8_t *dst, ptrdiff_t dst_stride,
+                           const ASS_Image *img, int cx0, int cw,
+                           int cy0, int cy1, int sx, int sy)
+{
+    int order = sx + sy;
+    for (int cy = cy0; cy < cy1; cy++) {
+        int y0 = FFMAX(cy << sy, img->dst_y) - img->dst_y;
+        int y1 = FFMIN((cy + 1) << sy, img->dst_y + img->h) - img->dst_y;
+        for (int i = 0; i < cw; i++) {
+            int x0 = FFMAX((cx0 + i) << sx, img->dst_x) - img->dst_x;
+            int x1 = FFMIN((cx0 + i + 1) << sx, img->dst_x + img->w) - img->dst_x;
+            unsigned sum = 0;
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++)
+                    sum += img->bitmap[y * img->stride + x];
+            dst[i] = (sum + ((1 << order) >> 1)) >> order;
+        }
+        dst += dst_stride;
+    }
+}
+
+typedef struct {
+    const BitmapEngine *engine;
+    const ASS_Image *images;
+    const ASS_YUVFrame *frame;
+    YUVMatrix matrix;
+    int height;
+    uint8_t *masks;         // subsampled coverage, mask_size bytes per thread
+    size_t mask_size;
+    ptrdiff_t mask_stride;
+} YUVJobs;
+
+// Blend the images into one horizontal band of the frame
+static void blend_yuv_band_job(void *priv, int job, int thread)
+{
+    YUVJobs *jobs = priv;
+    const ASS_YUVFrame *frame = jobs->frame;
+    int sx = frame->chroma_shift_x, sy = frame->chroma_shift_y;
+    bool wide = frame->bit_depth > 8;
+    int bytes = wide ? 2 : 1;
+    unsigned shift = wide && frame->msb_aligned ? 16 - frame->bit_depth : 0;
+    BlendYUVFunc *blend_plane =
+        wide ? jobs->engine->blend_plane16 : jobs->engine->blend_plane8;
+    BlendYUVFunc *blend_uv =
+        wide ? jobs->engine->blend_uv16 : jobs->engine->blend_uv8;
+    uint8_t *mask = jobs->masks + thread * jobs->mask_size;
+    ptrdiff_t mask_stride = jobs->mask_stride;
+
+    // bands start at multiples of the chroma subsampling
+    int y0 = job * YUV_BAND_HEIGHT;
+    int y1 = FFMIN(y0 + YUV_BAND_HEIGHT, jobs->height);
+    int c0 = y0 >> sy;
+    int c1 = (y1 + (1 << sy) - 1) >> sy;
+
+    for (const ASS_Image *img = jobs->images; img; img = img->next) {
+        unsigned alpha = 255 - (img->color & 0xFF);
+        if (img->w <= 0 || img->h <= 0 || !alpha)
+            continue;
+        unsigned yuv[3];
+        color_to_yuv(&jobs->matrix, img->color, frame->bit_depth, yuv);
+
+        int top = FFMAX(img->dst_y, y0);
+        int bottom = FFMIN(img->dst_y + img->h, y1);
+        if (top < bottom)
+            blend_plane(frame->planes[0] + top * (ptrdiff_t) frame->strides[0]
+                            + img->dst_x * bytes, frame->strides[0],
+                        img->bitmap + (top - img->dst_y) * img->stride,
+                        img->stride, img->w, bottom - top,
+                        yuv[0], alpha, shift);
+
+        int ctop = FFMAX(img->dst_y >> sy, c0);
+        int cbottom = FFMIN(((img->dst_y + img->h - 1) >> sy) + 1, c1);
+        if (ctop >= cbottom)
+            continue;
+        int cx0 = img->dst_x >> sx;
+        int cw = ((img->dst_x + img->w - 1) >> sx) + 1 - cx0;
+        subsample_mask(mask, mask_stride, img, cx0, cw, ctop, cbottom, sx, sy);
+
+        if (frame->layout == ASS_YUV_SEMI_PLANAR) {
+            blend_uv(frame->planes[1] + ctop * (ptrdiff_t) frame->strides[1]
+                         + 2 * cx0 * bytes, frame->strides[1],
+                     mask, mask_stride, cw, cbottom - ctop,
+                     yuv[1] | yuv[2] << 16, alpha, shift);
+            continue;
+        }
+        for (int i = 1; i < 3; i++)
+            blend_plane(frame->planes[i] + ctop * (ptrdiff_t) frame->strides[i]
+                            + cx0 * bytes, frame->strides[i],
+                        mask, mask_stride, cw, cbottom - ctop,
+                        yuv[i], alpha, shift);
+    }
+}
+
+static bool yuv_frame_valid(const ASS_YUVFrame *frame)
+{
+    if (frame->bit_depth < 8 || frame->bit_depth > 16)
+        return false;
+    // bands must start at multiples of the vertical subsampling
+    if (frame->chroma_shift_x < 0 || frame->chroma_shift_x > 2 ||
+            frame->chroma_shift_y < 0 || frame->chroma_shift_y > 2)
+        return false;
+    if (frame->layout == ASS_YUV_SEMI_PLANAR)
+        return frame->planes[0] && frame->planes[1];
+    return frame->layout == ASS_YUV_PLANAR &&
+        frame->planes[0] && frame->planes[1] && frame->planes[2];
+}
+
+int ass_render_frame_yuv(ASS_Renderer *priv, ASS_Track *track,
+                         long long now, const ASS_YUVFrame *frame,
+                         int *detect_change)
+{
+    YUVJobs jobs = {
+        .engine = &priv->engine,
+        .frame = frame,
+        .height = priv->settings.frame_height,
+    };
+    if (!priv->settings.frame_width || !jobs.height ||
+            !yuv_frame_valid(frame) ||
+            !get_yuv_matrix(&jobs.matrix, subtitle_matrix(track, frame->matrix))) {
+        if (detect_change)
+            *detect_change = 2;
+        return 0;
+    }
+
+    jobs.images = ass_render_frame(priv, track, now, detect_change);
+    if (!jobs.images)
+        return 1;
+
+    int sx = frame->chroma_shift_x, sy = frame->chroma_shift_y;
+    int max_cw = 0;
+    for (const ASS_Image *img = jobs.images; img; img = img->next)
+        if (img->w > 0)
+            max_cw = FFMAX(max_cw, ((img->dst_x + img->w - 1) >> sx) + 1 -
+                                   (img->dst_x >> sx));
+    int n_threads = ass_thread_pool_size(priv->thread_pool);
+    jobs.mask_stride = max_cw;
+    jobs.mask_size = (size_t) max_cw * ((YUV_BAND_HEIGHT >> sy) + 1);
+    jobs.masks = ass_realloc_array(NULL, n_threads, jobs.mask_size);
+    if (!jobs.masks)
+        return 0;
+
+    int n_bands = (jobs.height + YUV_BAND_HEIGHT - 1) / YUV_BAND_HEIGHT;
+    ass_thread_pool_run(priv->thread_pool, blend_yuv_band_job, &jobs, n_bands);
+    free(jobs.masks);
+    return 1;
+}
+
+#define FRAME_BATCH_SIZE 16
+
+typedef struct {
+    int first;          // slot of the first active event
+    int n_events;
+    bool reuse;         // returns the image list of the preceding frame
+} BatchFrame;
+
+static bool grow_batch(ASS_Renderer *priv, size_t n_slots)
+{
+    if (n_slots <= priv->batch.max_slots)
+        return true;
+    size_t new_max = FFMAX(n_slots, 2 * priv->batch.max_slots);
+    if (!ASS_REALLOC_ARRAY(priv->batch.events, new_max) ||
+            !ASS_REALLOC_ARRAY(priv->batch.times, new_max) ||
+            !ASS_REALLOC_ARRAY(priv->batch.slots, new_max))
+        return false;
+    priv->batch.max_slots = new_max;
+    return true;
+}
+
+static int add_frame_jobs(ASS_Renderer *priv, const BatchFrame *frame,
+                          int n_jobs)
+{
+    for (int i = 0; i < frame->n_events; i++)
+        priv->batch.slots[n_jobs++] = frame->first + i;
+    return n_jobs;
+}
+
+static bool frame_animated(ASS_Renderer *priv, const BatchFrame *frame)
+{
+    for (int i = 0; i < frame->n_events; i++)
+        if (priv->eimg[frame->first + i].animated)
+            return true;
+    return false;
+}
+
+/**
+ * \brief Render up to FRAME_BATCH_SIZE frames with one frame setup,
+ * spreading the events of all of them over the thread pool.
+ * Only collision handling and building the image lists are done
+ * frame by frame, in order, as collisions depend on the previous frame.
+ * \return false if out of memory before anything was rendered
+ */
+static bool render_batch(ASS_Renderer *priv, ASS_Track *track,
+                         const long long *times, int n,
+                         ASS_Image **images, int *detect_change)
+{
+    // find the active events of all frames in one pass over the time index
+    BatchFrame frames[FRAME_BATCH_SIZE];
+    size_t cursor = 0;
+    int n_slots = 0;
+    for (int i = 0; i < n; i++) {
+        int *active;
+        int n_active = ass_advance_active_events(track, times[i], &cursor, &active);
+        if (!grow_batch(priv, (size_t) n_slots + n_active))
+            return false;
+        frames[i].first = n_slots;
+        frames[i].n_events = n_active;
+        for (int j = 0; j < n_active; j++) {
+            priv->batch.events[n_slots + j] = active[j];
+            priv->batch.times[n_slots + j] = times[i];
+        }
+        n_slots += n_active;
+    }
+    if (n_slots > priv->eimg_size) {
+        int new_size = FFMAX(n_slots, priv->eimg_size + 100);
+        if (!ASS_REALLOC_ARRAY(priv->eimg, new_size))
+            return false;
+        priv->eimg_size = new_size;
+    }
+
+    int64_t start = 0;
+    if (priv->frame_timing) {
+        start = ass_time_ns();
+        reset_frame_timings(priv);
+    }
+
+    if (!ass_start_frame(priv, track)) {
+        for (int i = 0; i < n; i++) {
+            fail_frame(priv, detect_change ? detect_change + i : NULL);
+            images[i] = NULL;
+        }
+        if (priv->frame_timing)
+            collect_frame_timings(priv, start);
+        return true;
+    }
+
+    const int *events = priv->batch.events;
+    frames[0].reuse = last_frame_valid(priv, track, events, frames[0].n_events);
+    for (int i = 1; i < n; i++) {
+        const BatchFrame *prev = frames + i - 1;
+        frames[i].reuse = frames[i].n_events == prev->n_events &&
+            (!prev->n_events ||
+             !memcmp(events + frames[i].first, events + prev->first,
+                     prev->n_events * sizeof(int)));
+    }
+
+    // render the frames whose active events differ from their predecessor
+    int n_jobs = 0;
+    for (int i = 0; i < n; i++)
+        if (!frames[i].reuse)
+            n_jobs = add_frame_jobs(priv, frames + i, n_jobs);
+    RenderJobs jobs = {
+        .renderer = priv,
+        .events = events,
+        .times = priv->batch.times,
+        .slots = priv->batch.slots,
+    };
+    ass_thread_pool_run(priv->thread_pool, render_event_job, &jobs, n_jobs);
+
+    // frames following an animated one have to be rendered as well
+    n_jobs = 0;
+    bool animated = false;
+    for (int i = 0; i < n; i++) {
+        if (!frames[i].reuse) {
+            animated = frame_animated(priv, frames + i);
+        } else if (animated) {
+            frames[i].reuse = false;
+            n_jobs = add_frame_jobs(priv, frames + i, n_jobs);
+        }
+    }
+    if (n_jobs)
+        ass_thread_pool_run(priv->thread_pool, render_event_job, &jobs, n_jobs);
+    cache_group_end_frame(priv->cache_group);
+
+    for (int i = 0; i < n; i++) {
+        if (i) {
+            priv->prev_images_root = priv->images_root;
+            priv->images_root = NULL;
+        }
+        int *change = detect_change ? detect_change + i : NULL;
+        if (frames[i].reuse)
+            reuse_last_frame(priv, change);
+        else
+            compose_frame(priv, track, events + frames[i].first,
+                          frames[i].n_events, priv->eimg + frames[i].first,
+                          change);
+        images[i] = priv->images_root;
+        ass_frame_ref(images[i]);
+    }
+
+    if (track->parser_priv->prune_delay >= 0)
+        for (int i = 0; i < n; i++)
+            ass_prune_events(track, times[i] - track->parser_priv->prune_delay);
+
+    if (priv->frame_timing)
+        collect_frame_timings(priv, start);
+    return true;
+}
+
+/**
+ * \brief Render consecutive frames, taking a reference on each image list
+ * \param times timestamps, or NULL to use start + i * step
+ */
+static void render_frames(ASS_Renderer *priv, ASS_Track *track,
+                          const long long *times, long long start,
+                          long long step, int n, ASS_Image **images,
+                          int *detect_change)
+{
+    long long batch[FRAME_BATCH_SIZE];
+    for (int first = 0; first < n; first += FRAME_BATCH_SIZE) {
+        int count = FFMIN(n - first, FRAME_BATCH_SIZE);
+        for (int i = 0; i < count; i++)
+            batch[i] = times ? times[first + i] : start + (first + i) * step;
+        int *change = detect_change ? detect_change + first : NULL;
+        if (render_batch(priv, track, batch, count, images + first, change))
+            continue;
+
+        // out of memory, render the frames one by one
+        for (int i = 0; i < count; i++) {
+            images[first + i] = ass_render_frame(priv, track, batch[i],
+                                                 change ? change + i : NULL);
+            ass_frame_ref(images[first + i]);
+        }
+    }
+}
+
+void ass_render_frames(ASS_Renderer *priv, ASS_Track *track,
+                       const long long *times, int n,
+                       ASS_Image **images, int *detect_change)
+{
+    render_frames(priv, track, times, 0, 0, n, images, detect_change);
+}
+
+void ass_render_frame_range(ASS_Renderer *priv, ASS_Track *track,
+                            long long start, long long step, int n,
+                            ASS_Image **images, int *detect_change)
+{
+    render_frames(priv, track, NULL, start, step, n, images, detect_change);
+}
+
+void ass_release_frame(ASS_Image *img)
+{
+    ass_frame_unref(img);
+}
+
 /**
  * \brief Add reference to a frame image list.
  * \param image_list image list returned by ass_render_frame()
@@ -39,23 +39,41 @@
 #include "ass_drawing.h"
 #include "ass_bitmap.h"
 #include "ass_rasterizer.h"
+#include "ass_threading.h"
 
 #define GLYPH_CACHE_MAX 10000
 #define MEGABYTE (1024 * 1024)
 #define BITMAP_CACHE_MAX_SIZE (128 * MEGABYTE)
 #define COMPOSITE_CACHE_RATIO 2
 #define COMPOSITE_CACHE_MAX_SIZE (BITMAP_CACHE_MAX_SIZE / COMPOSITE_CACHE_RATIO)
+#define LAYOUT_CACHE_MAX_SIZE 256
+// limit of ass_get_damage() rectangles, more areas are merged into them
+#define MAX_DAMAGE_RECTS 32
 
 #define PARSED_FADE (1<<0)
 #define PARSED_A    (1<<1)
 
+// Image nodes are recycled through a pool of the renderer, their own
+// bitmap buffers go through the bitmap pool shared with the rasterizer
+// and blurs, so that steady rendering does not allocate
+#define BITMAP_POOL_MAX_SIZE (32 * MEGABYTE)
+
 typedef struct {
     ASS_Image result;
     CompositeHashValue *source;
     unsigned char *buffer;
+    size_t buffer_size;         // allocated size of buffer
     size_t ref_count;
+    struct image_pool *pool;
 } ASS_ImagePriv;
 
+typedef struct image_pool {
+    ASS_Mutex lock;
+    unsigned align;
+    ASS_ImagePriv *free_images;             // linked through result.next
+    BitmapPool *buffers;
+} ImagePool;
+
 typedef struct {
     int frame_width;
     int frame_height;
@@ -86,6 +104,7 @@ typedef struct {
     int detect_collisions;
     int shift_direction;
     ASS_Event *event;
+    bool animated;      // see RenderContext.animated
 } EventImages;
 
 typedef enum {
@@ -180,7 +199,7 @@ typedef struct glyph_info {
     struct glyph_info *next;
 } GlyphInfo;
 
-typedef struct {
+typedef struct line_info {
     double asc, desc;
 } LineInfo;
 
@@ -200,10 +219,28 @@ typedef struct {
     int max_glyphs;
     int max_lines;
     unsigned max_bitmaps;
+    // allocator of cluster continuations (GlyphInfo.next) and
+    // CombinedBitmapInfo.bitmaps, the arena of the owning RenderContext
+    ASS_Arena *arena;
 } TextInfo;
 
 #include "ass_shaper.h"
 
+// Pipeline stages timed with ass_set_frame_timing(),
+// see ASS_FrameTimings for their meaning
+typedef enum {
+    STAGE_OTHER,
+    STAGE_PARSE,
+    STAGE_SHAPE,
+    STAGE_WRAP,
+    STAGE_OUTLINE,
+    STAGE_STROKE,
+    STAGE_RASTER,
+    STAGE_COMPOSITE,
+    STAGE_RENDER_TEXT,
+    STAGE_COUNT
+} RenderStage;
+
 // Renderer state.
 // Values like current font face, color, screen position, clipping and so on are stored here.
 struct render_context {
@@ -212,8 +249,25 @@ struct render_context {
     ASS_Shaper *shaper;
     RasterizerData rasterizer;
 
+    // short-lived data of the events rendered in the current frame,
+    // reset by ass_start_frame()
+    ASS_Arena arena;
+
+    // scratch buffers for layout cache keys, see layout_event()
+    GlyphInfo *layout_glyphs;
+    int max_layout_glyphs;
+    char *layout_drawings;
+    size_t max_layout_drawings;
+
+    // time accounting of the current frame, see enter_stage()
+    RenderStage stage;
+    int64_t stage_start;
+    int64_t stage_time[STAGE_COUNT];
+
     ASS_Event *event;
     ASS_Style *style;
+    long long time;             // timestamp of the frame of the event, ms
+    bool animated;              // output depends on the frame time
 
     ASS_Font *font;
     double font_size;
@@ -296,32 +350,84 @@ struct render_context {
 
 typedef struct render_context RenderContext;
 
+// Caches that depend on the frame geometry and are private to a renderer
 typedef struct {
-    Cache *font_cache;
-    Cache *outline_cache;
     Cache *bitmap_cache;
     Cache *composite_cache;
-    Cache *face_size_metrics_cache;
-    Cache *metrics_cache;
-    size_t glyph_max;
+    Cache *layout_cache;
     size_t bitmap_max_size;
     size_t composite_max_size;
 } CacheStore;
 
-struct ass_renderer {
+// Font state and resolution-independent caches,
+// shared by all renderers attached to the group
+struct ass_cache_group {
     ASS_Library *library;
     FT_Library ftlibrary;
     ASS_FontSelector *fontselect;
     size_t num_emfonts;
+    unsigned font_generation;   // incremented whenever fonts are added or replaced
+
+    // arguments of the ass_set_fonts() call that created fontselect
+    // and the font settings of the library at the time, valid if fonts_set
+    bool fonts_set;
+    char *default_font;
+    char *default_family;
+    char *fonts_config;
+    int font_provider;
+    char *fonts_dir;
+    char *font_index;
+
+    Cache *font_cache;
+    Cache *outline_cache;
+    Cache *face_size_metrics_cache;
+    Cache *metrics_cache;
+    size_t glyph_max;
+
+    // serializes FreeType and font selection calls of concurrent threads
+    ASS_Mutex font_lock;
+
+    // protects the fields below
+    ASS_Mutex lock;
+    ASS_Cond idle;
+    int active_frames;      // frames currently being rendered by members
+    size_t cut_size;        // outline cache size left by the last cut
+
+    size_t ref_count;       // handle returned to the user + attached renderers
+};
+
+struct ass_renderer {
+    ASS_Library *library;
+    ASS_CacheGroup *cache_group;
     ASS_Settings settings;
     int render_id;
 
     ASS_Image *images_root;     // rendering result is stored here
     ASS_Image *prev_images_root;
+    ImagePool image_pool;
+    BitmapPool *bitmap_pool;
+
+    // areas changed by the last frame, see ass_get_damage()
+    struct {
+        ASS_DamageRect rects[MAX_DAMAGE_RECTS];
+        int n_rects;
+        bool prev_valid;        // the previous call returned prev_images_root
+        ASS_Image **images;     // scratch for comparing image lists
+        size_t max_images;
+    } damage;
 
     EventImages *eimg;          // temporary buffer for sorting rendered events
     int eimg_size;              // allocated buffer size
 
+    // scratch of ass_render_frames(), one slot per active event of each
+    // frame of a batch, matching eimg
+    struct {
+        int *events;            // event of each slot
+        long long *times;       // frame time of each slot
+        int *slots;             // slots to render in one thread pool run
+        size_t max_slots;
+    } batch;
+
     // frame-global data
     int width, height;          // screen dimensions (the whole frame from ass_set_frame_size)
     int frame_content_height;   // content frame height ( = screen height - API margins )
@@ -329,12 +435,34 @@ struct ass_renderer {
     double fit_height;          // content frame height without zoom & pan (fit to screen & letterboxed)
     double fit_width;           // content frame width without zoom & pan (fit to screen & letterboxed)
     ASS_Track *track;
-    long long time;             // frame's timestamp, ms
     double par_scale_x;        // x scale applied to all glyphs to preserve text aspect ratio
 
     RenderContext state;
     CacheStore cache;
 
+    // parallel event rendering, see ass_set_threads()
+    ASS_ThreadPool *thread_pool;
+    RenderContext *worker_states;   // contexts of threads 1..n-1
+    // scratch of thread 0 for banded rasterization, threads 1..n-1
+    // use the rasterizers of their contexts
+    RasterizerData band_rasterizer;
+
+    bool frame_timing;          // see ass_set_frame_timing()
+    bool merge_images;          // see ass_set_image_merging()
+    ASS_FrameTimings timings;   // of the last frame
+
+    // The last rendered frame is returned again if it contains no animation
+    // and neither the active events nor the settings have changed since.
+    unsigned font_generation;   // of the cache group, read at frame start
+    struct {
+        bool reusable;          // cleared by any change of the settings
+        size_t track_id;
+        unsigned track_generation;
+        unsigned font_generation;
+        int *events;            // indices of the active events, ascending
+        int n_events, max_events;
+    } last_frame;
+
     BitmapEngine engine;
 
     ASS_Style user_override_style;
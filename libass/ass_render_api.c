@@ -31,9 +31,10 @@ static void ass_reconfigure(ASS_Renderer *priv)
     ASS_Settings *settings = &priv->settings;
 
     priv->render_id++;
+    priv->last_frame.reusable = false;
     ass_cache_empty(priv->cache.composite_cache);
     ass_cache_empty(priv->cache.bitmap_cache);
-    ass_cache_empty(priv->cache.outline_cache);
+    ass_cache_empty(priv->cache.layout_cache);
 
     priv->width = settings->frame_width;
     priv->height = settings->frame_height;
@@ -79,10 +80,13 @@ void ass_set_storage_size(ASS_Renderer *priv, int w, int h)
 void ass_set_shaper(ASS_Renderer *priv, ASS_ShapingLevel level)
 {
     // select the complex shaper for illegal values
-    if (level == ASS_SHAPING_SIMPLE || level == ASS_SHAPING_COMPLEX)
+    if (level != ASS_SHAPING_SIMPLE && level != ASS_SHAPING_COMPLEX)
+        level = ASS_SHAPING_COMPLEX;
+    if (priv->settings.shaper != level) {
         priv->settings.shaper = level;
-    else
-        priv->settings.shaper = ASS_SHAPING_COMPLEX;
+        priv->last_frame.reusable = false;
+        ass_cache_empty(priv->cache.layout_cache);
+    }
 }
 
 void ass_set_margins(ASS_Renderer *priv, int t, int b, int l, int r)
@@ -99,7 +103,10 @@ void ass_set_margins(ASS_Renderer *priv, int t, int b, int l, int r)
 
 void ass_set_use_margins(ASS_Renderer *priv, int use)
 {
-    priv->settings.use_margins = use;
+    if (priv->settings.use_margins != use) {
+        priv->settings.use_margins = use;
+        priv->last_frame.reusable = false;
+    }
 }
 
 void ass_set_aspect_ratio(ASS_Renderer *priv, double dar, double sar)
@@ -134,7 +141,11 @@ void ass_set_hinting(ASS_Renderer *priv, ASS_Hinting ht)
 
 void ass_set_line_spacing(ASS_Renderer *priv, double line_spacing)
 {
-    priv->settings.line_spacing = line_spacing;
+    if (priv->settings.line_spacing != line_spacing) {
+        priv->settings.line_spacing = line_spacing;
+        priv->last_frame.reusable = false;
+        ass_cache_empty(priv->cache.layout_cache);
+    }
 }
 
 void ass_set_line_position(ASS_Renderer *priv, double line_position)
@@ -145,6 +156,21 @@ void ass_set_line_position(ASS_Renderer *priv, double line_position)
     }
 }
 
+static bool str_equal(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp(a, b));
+}
+
+static bool replace_str(char **dst, const char *src)
+{
+    char *copy = NULL;
+    if (src && !(copy = strdup(src)))
+        return false;
+    free(*dst);
+    *dst = copy;
+    return true;
+}
+
 void ass_set_fonts(ASS_Renderer *priv, const char *default_font,
                    const char *default_family, int dfp,
                    const char *config, int update)
@@ -155,15 +181,41 @@ void ass_set_fonts(ASS_Renderer *priv, const char *default_font,
     priv->settings.default_family =
         default_family ? strdup(default_family) : 0;
 
+    // Fonts are shared with the other renderers of the group, which
+    // typically all get the same configuration. Only the first such call
+    // replaces the fonts, the caches of the group stay valid otherwise.
+    ASS_CacheGroup *group = priv->cache_group;
+    ASS_Library *library = group->library;
+    if (group->fonts_set && group->fontselect &&
+            group->font_provider == dfp &&
+            str_equal(group->default_font, default_font) &&
+            str_equal(group->default_family, default_family) &&
+            str_equal(group->fonts_config, config) &&
+            str_equal(group->fonts_dir, library->fonts_dir) &&
+            str_equal(group->font_index, library->font_index))
+        return;
+
     ass_reconfigure(priv);
 
-    ass_cache_empty(priv->cache.font_cache);
-    ass_cache_empty(priv->cache.metrics_cache);
+    // outlines and metrics refer to the faces that are about to be replaced
+    ass_cache_empty(group->outline_cache);
+    ass_cache_empty(group->face_size_metrics_cache);
+    ass_cache_empty(group->metrics_cache);
+    ass_cache_empty(group->font_cache);
 
-    if (priv->fontselect)
-        ass_fontselect_free(priv->fontselect);
-    priv->fontselect = ass_fontselect_init(priv->library, priv->ftlibrary,
-            &priv->num_emfonts, default_family, default_font, config, dfp);
+    if (group->fontselect)
+        ass_fontselect_free(group->fontselect);
+    group->fontselect = ass_fontselect_init(library, group->ftlibrary,
+            &group->num_emfonts, default_family, default_font, config, dfp);
+    group->font_generation++;
+
+    // if a copy fails, the next call replaces the fonts again
+    group->fonts_set = replace_str(&group->default_font, default_font) &&
+                       replace_str(&group->default_family, default_family) &&
+                       replace_str(&group->fonts_config, config) &&
+                       replace_str(&group->fonts_dir, library->fonts_dir) &&
+                       replace_str(&group->font_index, library->font_index);
+    group->font_provider = dfp;
 }
 
 void ass_set_selective_style_override_enabled(ASS_Renderer *priv, int bits)
@@ -192,7 +244,7 @@ int ass_fonts_update(ASS_Renderer *render_priv)
 void ass_set_cache_limits(ASS_Renderer *render_priv, int glyph_max,
                           int bitmap_max)
 {
-    render_priv->cache.glyph_max = glyph_max ? glyph_max : GLYPH_CACHE_MAX;
+    render_priv->cache_group->glyph_max = glyph_max ? glyph_max : GLYPH_CACHE_MAX;
 
     size_t bitmap_cache, composite_cache;
     if (bitmap_max) {
@@ -207,9 +259,59 @@ void ass_set_cache_limits(ASS_Renderer *render_priv, int glyph_max,
     render_priv->cache.composite_max_size = composite_cache;
 }
 
+void ass_set_bitmap_pool_limit(ASS_Renderer *priv, int max_size)
+{
+    size_t size = BITMAP_POOL_MAX_SIZE;
+    if (max_size)
+        size = max_size > 0 ? MEGABYTE * (size_t) max_size : 0;
+    ass_bitmap_pool_set_limit(priv->bitmap_pool, size);
+}
+
+int ass_renderer_get_cache_stats(ASS_Renderer *priv, ASS_CacheType cache,
+                                 ASS_CacheStats *stats)
+{
+    ASS_CacheGroup *group = priv->cache_group;
+    Cache *caches[] = {
+        [ASS_CACHE_FONT]              = group->font_cache,
+        [ASS_CACHE_OUTLINE]           = group->outline_cache,
+        [ASS_CACHE_BITMAP]            = priv->cache.bitmap_cache,
+        [ASS_CACHE_COMPOSITE]         = priv->cache.composite_cache,
+        [ASS_CACHE_FACE_SIZE_METRICS] = group->face_size_metrics_cache,
+        [ASS_CACHE_GLYPH_METRICS]     = group->metrics_cache,
+        [ASS_CACHE_LAYOUT]            = priv->cache.layout_cache,
+    };
+    if ((unsigned) cache >= sizeof(caches) / sizeof(*caches))
+        return 0;
+    ass_cache_get_stats(caches[cache], stats);
+    return 1;
+}
+
+void ass_set_frame_timing(ASS_Renderer *priv, int enable)
+{
+    priv->frame_timing = enable;
+    memset(&priv->timings, 0, sizeof(priv->timings));
+}
+
+int ass_get_frame_timings(ASS_Renderer *priv, ASS_FrameTimings *timings)
+{
+    if (!priv->frame_timing)
+        return 0;
+    *timings = priv->timings;
+    return 1;
+}
+
+void ass_set_image_merging(ASS_Renderer *priv, int enable)
+{
+    if (priv->merge_images != !!enable) {
+        priv->merge_images = enable;
+        priv->last_frame.reusable = false;
+    }
+}
+
 ASS_FontProvider *
 ass_create_font_provider(ASS_Renderer *priv, ASS_FontProviderFuncs *funcs,
                          void *data)
 {
-    return ass_font_provider_new(priv->fontselect, funcs, data);
+    priv->cache_group->font_generation++;
+    return ass_font_provider_new(priv->cache_group->fontselect, funcs, data);
 }
@@ -611,9 +611,11 @@ hb_shaper_get_run_language(ASS_Shaper *shaper, hb_script_t script)
  * \param glyphs GlyphInfo array
  * \param buf buffer of shaped run
  * \param offset offset into GlyphInfo array
+ * \param arena allocator of cluster continuations
  */
 static void
-shape_harfbuzz_process_run(GlyphInfo *glyphs, hb_buffer_t *buf, int offset)
+shape_harfbuzz_process_run(GlyphInfo *glyphs, hb_buffer_t *buf, int offset,
+                           ASS_Arena *arena)
 {
     int j;
     int num_glyphs = hb_buffer_get_length(buf);
@@ -630,7 +632,7 @@ shape_harfbuzz_process_run(GlyphInfo *glyphs, hb_buffer_t *buf, int offset)
         if (!info->skip) {
             while (info->next)
                 info = info->next;
-            info->next = malloc(sizeof(GlyphInfo));
+            info->next = ass_arena_alloc(arena, sizeof(GlyphInfo));
             if (info->next) {
                 memcpy(info->next, info, sizeof(GlyphInfo));
                 info = info->next;
@@ -656,8 +658,10 @@ shape_harfbuzz_process_run(GlyphInfo *glyphs, hb_buffer_t *buf, int offset)
  * \brief Shape event text with HarfBuzz. Full OpenType shaping.
  * \param glyphs glyph clusters
  * \param len number of clusters
+ * \param arena allocator of cluster continuations
  */
-static bool shape_harfbuzz(ASS_Shaper *shaper, GlyphInfo *glyphs, size_t len)
+static bool shape_harfbuzz(ASS_Shaper *shaper, GlyphInfo *glyphs, size_t len,
+                           ASS_Arena *arena)
 {
     int i;
     hb_buffer_t *buf = shaper->buf;
@@ -715,7 +719,7 @@ static bool shape_harfbuzz(ASS_Shaper *shaper, GlyphInfo *glyphs, size_t len)
         hb_shape(font, buf, shaper->features, shaper->n_features);
 
         shape_harfbuzz_process_run(glyphs, buf,
-                shaper->whole_text_layout ? 0 : offset - lead_context);
+                shaper->whole_text_layout ? 0 : offset - lead_context, arena);
         hb_buffer_reset(buf);
 
         hb_font_destroy(font);
@@ -866,7 +870,7 @@ void ass_shaper_find_runs(ASS_Shaper *shaper, ASS_Renderer *render_priv,
         GlyphInfo *info = glyphs + i;
         if (!info->drawing_text.str && !info->skip) {
             // get font face and glyph index
-            ass_font_get_index(render_priv->fontselect, info->font,
+            ass_font_get_index(render_priv->cache_group->fontselect, info->font,
                     info->symbol, &info->face_index, &info->glyph_index);
         }
         if (i > 0) {
@@ -1010,7 +1014,7 @@ bool ass_shaper_shape(ASS_Shaper *shaper, TextInfo *text_info)
         return true;
     case ASS_SHAPING_COMPLEX:
     default:
-        return shape_harfbuzz(shaper, glyphs, text_info->length);
+        return shape_harfbuzz(shaper, glyphs, text_info->length, text_info->arena);
     }
 }
 
@@ -1060,25 +1064,6 @@ error:
 }
 
 
-/**
- * \brief clean up additional data temporarily needed for shaping and
- * (e.g. additional glyphs allocated)
- */
-void ass_shaper_cleanup(ASS_Shaper *shaper, TextInfo *text_info)
-{
-    int i;
-
-    for (i = 0; i < text_info->length; i++) {
-        GlyphInfo *info = text_info->glyphs + i;
-        info = info->next;
-        while (info) {
-            GlyphInfo *next = info->next;
-            free(info);
-            info = next;
-        }
-    }
-}
-
 /**
  * \brief Calculate reorder map to render glyphs in visual order
  * \param shaper shaper instance
@@ -45,7 +45,6 @@ void ass_shaper_set_bidi_brackets(ASS_Shaper *shaper, bool match_brackets);
 #endif
 void ass_shaper_set_whole_text_layout(ASS_Shaper *shaper, bool enable);
 bool ass_shaper_shape(ASS_Shaper *shaper, TextInfo *text_info);
-void ass_shaper_cleanup(ASS_Shaper *shaper, TextInfo *text_info);
 FriBidiStrIndex *ass_shaper_reorder(ASS_Shaper *shaper, TextInfo *text_info);
 FriBidiStrIndex *ass_shaper_get_reorder_map(ASS_Shaper *shaper);
 FriBidiParType ass_resolve_base_direction(int font_encoding);
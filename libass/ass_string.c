@@ -73,3 +73,14 @@ int ass_strncasecmp(const char *s1, const char *s2, size_t n)
     return a - b;
 }
 
+
+/**
+ * \brief Hash a string consistently with ass_strcasecmp (FNV-1a).
+ */
+unsigned ass_strcasehash(const char *str)
+{
+    unsigned hash = 2166136261u;
+    while (*str)
+        hash = (hash ^ lowertab[(unsigned char) *str++]) * 16777619u;
+    return hash;
+}
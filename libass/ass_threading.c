@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdlib.h>
+
+#include "ass_threading.h"
+
+static void run_sequential(ASS_ThreadJobFunc func, void *priv, int n_jobs)
+{
+    for (int i = 0; i < n_jobs; i++)
+        func(priv, i, 0);
+}
+
+#ifdef CONFIG_PTHREAD
+
+struct ass_thread_pool {
+    int n_threads;
+    pthread_t *threads;
+    struct ass_thread_worker *workers;
+
+    ASS_Mutex lock;
+    ASS_Cond work_cond, done_cond;
+
+    // current batch, protected by lock
+    ASS_ThreadJobFunc func;
+    void *priv;
+    int n_jobs, next_job;
+    int active;          // workers still busy with the current batch
+    unsigned generation; // incremented for every batch
+    bool busy, quit;
+};
+
+struct ass_thread_worker {
+    ASS_ThreadPool *pool;
+    int index;
+};
+
+// Take jobs of the current batch until none are left; called with lock held.
+static void process_jobs(ASS_ThreadPool *pool, int thread)
+{
+    while (pool->next_job < pool->n_jobs) {
+        int job = pool->next_job++;
+        ASS_ThreadJobFunc func = pool->func;
+        void *priv = pool->priv;
+
+        ass_mutex_unlock(&pool->lock);
+        func(priv, job, thread);
+        ass_mutex_lock(&pool->lock);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    struct ass_thread_worker *worker = arg;
+    ASS_ThreadPool *pool = worker->pool;
+    unsigned generation = 0;
+
+    ass_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->quit && pool->generation == generation)
+            ass_cond_wait(&pool->work_cond, &pool->lock);
+        if (pool->quit)
+            break;
+        generation = pool->generation;
+
+        process_jobs(pool, worker->index);
+        if (!--pool->active)
+            ass_cond_broadcast(&pool->done_cond);
+    }
+    ass_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ASS_ThreadPool *ass_thread_pool_create(int n_threads)
+{
+    if (n_threads < 2)
+        return NULL;
+    if (n_threads > ASS_MAX_THREADS)
+        n_threads = ASS_MAX_THREADS;
+
+    ASS_ThreadPool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+    pool->threads = calloc(n_threads - 1, sizeof(*pool->threads));
+    pool->workers = calloc(n_threads - 1, sizeof(*pool->workers));
+    if (!pool->threads || !pool->workers)
+        goto fail_alloc;
+
+    if (!ass_mutex_init(&pool->lock, false))
+        goto fail_alloc;
+    if (!ass_cond_init(&pool->work_cond))
+        goto fail_mutex;
+    if (!ass_cond_init(&pool->done_cond))
+        goto fail_work_cond;
+
+    pool->n_threads = 1;
+    for (int i = 0; i < n_threads - 1; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i + 1;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]))
+            break;
+        pool->n_threads++;
+    }
+    if (pool->n_threads < 2) {
+        ass_thread_pool_free(pool);
+        return NULL;
+    }
+    return pool;
+
+fail_work_cond:
+    ass_cond_destroy(&pool->work_cond);
+fail_mutex:
+    ass_mutex_destroy(&pool->lock);
+fail_alloc:
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+}
+
+void ass_thread_pool_free(ASS_ThreadPool *pool)
+{
+    if (!pool)
+        return;
+
+    ass_mutex_lock(&pool->lock);
+    pool->quit = true;
+    ass_cond_broadcast(&pool->work_cond);
+    ass_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->n_threads - 1; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    ass_cond_destroy(&pool->done_cond);
+    ass_cond_destroy(&pool->work_cond);
+    ass_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
+
+int ass_thread_pool_size(const ASS_ThreadPool *pool)
+{
+    return pool ? pool->n_threads : 1;
+}
+
+bool ass_thread_pool_available(ASS_ThreadPool *pool)
+{
+    if (!pool)
+        return false;
+    ass_mutex_lock(&pool->lock);
+    bool busy = pool->busy;
+    ass_mutex_unlock(&pool->lock);
+    return !busy;
+}
+
+void ass_thread_pool_run(ASS_ThreadPool *pool, ASS_ThreadJobFunc func,
+                         void *priv, int n_jobs)
+{
+    if (!pool || n_jobs < 2) {
+        run_sequential(func, priv, n_jobs);
+        return;
+    }
+
+    ass_mutex_lock(&pool->lock);
+    if (pool->busy) {
+        ass_mutex_unlock(&pool->lock);
+        run_sequential(func, priv, n_jobs);
+        return;
+    }
+    pool->busy = true;
+    pool->func = func;
+    pool->priv = priv;
+    pool->n_jobs = n_jobs;
+    pool->next_job = 0;
+    pool->active = pool->n_threads - 1;
+    pool->generation++;
+    ass_cond_broadcast(&pool->work_cond);
+
+    process_jobs(pool, 0);
+    while (pool->active)
+        ass_cond_wait(&pool->done_cond, &pool->lock);
+    pool->busy = false;
+    ass_mutex_unlock(&pool->lock);
+}
+
+#else
+
+ASS_ThreadPool *ass_thread_pool_create(int n_threads)
+{
+    return NULL;
+}
+
+void ass_thread_pool_free(ASS_ThreadPool *pool)
+{
+}
+
+int ass_thread_pool_size(const ASS_ThreadPool *pool)
+{
+    return 1;
+}
+
+bool ass_thread_pool_available(ASS_ThreadPool *pool)
+{
+    return false;
+}
+
+void ass_thread_pool_run(ASS_ThreadPool *pool, ASS_ThreadJobFunc func,
+                         void *priv, int n_jobs)
+{
+    run_sequential(func, priv, n_jobs);
+}
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_THREADING_H
+#define LIBASS_THREADING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Thin wrappers around the platform threading primitives.
+ * Without thread support everything degrades to no-ops
+ * and thread pools run all jobs on the calling thread.
+ */
+
+#ifdef CONFIG_PTHREAD
+
+#include <pthread.h>
+
+static inline size_t ass_atomic_load(const size_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+// returns the new value
+static inline size_t ass_atomic_inc(size_t *ptr)
+{
+    return __atomic_add_fetch(ptr, 1, __ATOMIC_RELAXED);
+}
+
+// returns the new value
+static inline size_t ass_atomic_dec(size_t *ptr)
+{
+    return __atomic_sub_fetch(ptr, 1, __ATOMIC_ACQ_REL);
+}
+
+// on failure, *expected is updated to the current value
+static inline bool ass_atomic_cas(size_t *ptr, size_t *expected, size_t desired)
+{
+    return __atomic_compare_exchange_n(ptr, expected, desired, true,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+typedef pthread_mutex_t ASS_Mutex;
+typedef pthread_cond_t ASS_Cond;
+
+static inline bool ass_mutex_init(ASS_Mutex *mutex, bool recursive)
+{
+    if (!recursive)
+        return !pthread_mutex_init(mutex, NULL);
+
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr))
+        return false;
+    bool ok = !pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) &&
+              !pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+static inline void ass_mutex_destroy(ASS_Mutex *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+static inline void ass_mutex_lock(ASS_Mutex *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+static inline void ass_mutex_unlock(ASS_Mutex *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+static inline bool ass_cond_init(ASS_Cond *cond)
+{
+    return !pthread_cond_init(cond, NULL);
+}
+
+static inline void ass_cond_destroy(ASS_Cond *cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+static inline void ass_cond_wait(ASS_Cond *cond, ASS_Mutex *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+static inline void ass_cond_broadcast(ASS_Cond *cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+#else
+
+static inline size_t ass_atomic_load(const size_t *ptr)
+{
+    return *ptr;
+}
+
+static inline size_t ass_atomic_inc(size_t *ptr)
+{
+    return ++*ptr;
+}
+
+static inline size_t ass_atomic_dec(size_t *ptr)
+{
+    return --*ptr;
+}
+
+static inline bool ass_atomic_cas(size_t *ptr, size_t *expected, size_t desired)
+{
+    if (*ptr != *expected) {
+        *expected = *ptr;
+        return false;
+    }
+    *ptr = desired;
+    return true;
+}
+
+typedef struct { char unused; } ASS_Mutex;
+typedef struct { char unused; } ASS_Cond;
+
+static inline bool ass_mutex_init(ASS_Mutex *mutex, bool recursive)
+{
+    return true;
+}
+
+static inline void ass_mutex_destroy(ASS_Mutex *mutex) {}
+static inline void ass_mutex_lock(ASS_Mutex *mutex) {}
+static inline void ass_mutex_unlock(ASS_Mutex *mutex) {}
+
+static inline bool ass_cond_init(ASS_Cond *cond)
+{
+    return true;
+}
+
+static inline void ass_cond_destroy(ASS_Cond *cond) {}
+// waiting is only ever needed when another thread can make progress
+static inline void ass_cond_wait(ASS_Cond *cond, ASS_Mutex *mutex) {}
+static inline void ass_cond_broadcast(ASS_Cond *cond) {}
+
+#endif
+
+// maximal number of threads accepted by ass_thread_pool_create()
+#define ASS_MAX_THREADS 64
+
+typedef struct ass_thread_pool ASS_ThreadPool;
+
+/*
+ * Job callback: job is the index of the job in [0, n_jobs),
+ * thread is the index of the executing thread in [0, pool size).
+ * Each thread runs at most one job at a time, so the thread index
+ * can be used to select per-thread scratch state.
+ */
+typedef void (*ASS_ThreadJobFunc)(void *priv, int job, int thread);
+
+/**
+ * \brief Create a pool of worker threads.
+ * \param n_threads total number of threads, including the caller of
+ * ass_thread_pool_run(), so n_threads - 1 workers are spawned
+ * \return the pool, or NULL if n_threads < 2,
+ * threading is not available or on allocation failure
+ */
+ASS_ThreadPool *ass_thread_pool_create(int n_threads);
+void ass_thread_pool_free(ASS_ThreadPool *pool);
+
+/**
+ * \brief Number of threads in the pool; 1 for a NULL pool.
+ */
+int ass_thread_pool_size(const ASS_ThreadPool *pool);
+
+/**
+ * \brief Whether ass_thread_pool_run() would currently spread jobs over
+ * several threads, i.e. the pool has workers and is not executing jobs.
+ * Callers can skip the setup of parallel work when it would run sequentially.
+ */
+bool ass_thread_pool_available(ASS_ThreadPool *pool);
+
+/**
+ * \brief Run n_jobs jobs and wait for all of them to finish.
+ * The calling thread participates as thread 0. A NULL pool, or a pool
+ * that is already executing jobs (i.e. the call is made from inside a job),
+ * runs all jobs sequentially on the calling thread with thread index 0;
+ * callbacks that can be nested must therefore not rely on the thread index.
+ */
+void ass_thread_pool_run(ASS_ThreadPool *pool, ASS_ThreadJobFunc func,
+                         void *priv, int n_jobs);
+
+#endif /* LIBASS_THREADING_H */
@@ -56,8 +56,10 @@
  *      invoked, except for ass_track_set_feature and ass_flush_events.
  *  - After the first call to ass_render_frame, existing array members
  *    (e.g. members of events) and non-array track fields (e.g. PlayResX
- *    or event_format) must not be modified. Adding new members to arrays
- *    and updating the corresponding counter remains allowed.
+ *    or event_format) must only be modified if ass_track_invalidate is
+ *    called afterwards, before the next ass_render_frame. Adding new members
+ *    to arrays and updating the corresponding counter remains allowed
+ *    without it.
  *  - Adding and removing members to array fields, like events or styles,
  *    must be done through the corresponding API function, e.g. ass_alloc_event.
  *    See the documentation of these functions.
@@ -101,6 +103,7 @@ typedef struct ass_renderer ASS_Renderer;
 typedef struct render_priv ASS_RenderPriv;
 typedef struct parser_priv ASS_ParserPriv;
 typedef struct ass_library ASS_Library;
+typedef struct ass_cache_group ASS_CacheGroup;
 
 /* ASS Style: line */
 typedef struct ass_style {
@@ -24,6 +24,12 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
 
 #include "ass_library.h"
 #include "ass.h"
@@ -79,6 +85,32 @@ void ass_aligned_free(void *ptr)
         free(*((void **)ptr - 1));
 }
 
+/**
+ * \brief Monotonic clock for performance measurements
+ * \return time in nanoseconds since an arbitrary starting point
+ */
+int64_t ass_time_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return t.QuadPart / freq.QuadPart * 1000000000 +
+           t.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom)
+        mach_timebase_info(&timebase);
+    return (int64_t) (mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000LL * ts.tv_sec + ts.tv_nsec;
+#endif
+}
+
 /**
  * This works similar to realloc(ptr, nmemb * size), but checks for overflow.
  *
@@ -114,6 +146,109 @@ void *ass_try_realloc_array(void *ptr, size_t nmemb, size_t size)
     }
 }
 
+#define ARENA_MIN_BLOCK 4096
+
+struct ass_arena_block {
+    ASS_ArenaBlock *prev;
+    size_t size;
+};
+
+// offset of the data that follows each block header
+#define ARENA_HEADER ((sizeof(ASS_ArenaBlock) + ASS_ARENA_ALIGN - 1) & ~(ASS_ARENA_ALIGN - 1))
+
+static inline char *arena_data(ASS_ArenaBlock *block)
+{
+    return (char *) block + ARENA_HEADER;
+}
+
+static bool arena_add_block(ASS_Arena *arena, size_t size)
+{
+    size = FFMAX(size, FFMAX(arena->total, ARENA_MIN_BLOCK));
+    if (size > SIZE_MAX - ARENA_HEADER)
+        return false;
+    ASS_ArenaBlock *block = ass_aligned_alloc(ASS_ARENA_ALIGN, ARENA_HEADER + size, false);
+    if (!block)
+        return false;
+    block->prev = arena->block;
+    block->size = size;
+    arena->block = block;
+    arena->pos = 0;
+    arena->total += size;
+    return true;
+}
+
+/**
+ * \brief Allocate size bytes, uninitialized, that stay valid
+ * until the next ass_arena_reset() or ass_arena_free()
+ * \return the memory, or NULL on allocation failure
+ */
+void *ass_arena_alloc(ASS_Arena *arena, size_t size)
+{
+    size = ass_align(ASS_ARENA_ALIGN, size);
+    if (size > SIZE_MAX - ASS_ARENA_ALIGN)
+        return NULL;
+    if (!arena->block || arena->block->size - arena->pos < size)
+        if (!arena_add_block(arena, size))
+            return NULL;
+    void *ptr = arena_data(arena->block) + arena->pos;
+    arena->pos += size;
+    return ptr;
+}
+
+/**
+ * \brief Grow an array allocated from the arena to nmemb elements.
+ * The last allocation is extended in place if possible,
+ * otherwise the contents are copied to a new allocation.
+ * \return the array, or NULL on allocation failure;
+ * ptr stays valid in any case
+ */
+void *ass_arena_realloc_array(ASS_Arena *arena, void *ptr,
+                              size_t old_nmemb, size_t nmemb, size_t size)
+{
+    if (nmemb > SIZE_MAX / size)
+        return NULL;
+    size_t old_size = ass_align(ASS_ARENA_ALIGN, old_nmemb * size);
+    size_t new_size = nmemb * size;
+    ASS_ArenaBlock *block = arena->block;
+    if (ptr && block && (char *) ptr + old_size == arena_data(block) + arena->pos &&
+            ass_align(ASS_ARENA_ALIGN, new_size) - old_size <= block->size - arena->pos) {
+        arena->pos += ass_align(ASS_ARENA_ALIGN, new_size) - old_size;
+        return ptr;
+    }
+
+    void *new_ptr = ass_arena_alloc(arena, new_size);
+    if (new_ptr && ptr)
+        memcpy(new_ptr, ptr, FFMIN(old_nmemb, nmemb) * size);
+    return new_ptr;
+}
+
+/**
+ * \brief Release all allocations of the arena, keeping its memory.
+ */
+void ass_arena_reset(ASS_Arena *arena)
+{
+    arena->pos = 0;
+    if (!arena->block || !arena->block->prev)
+        return;
+
+    size_t total = arena->total;
+    ass_arena_free(arena);
+    arena_add_block(arena, total);
+}
+
+void ass_arena_free(ASS_Arena *arena)
+{
+    ASS_ArenaBlock *block = arena->block;
+    while (block) {
+        ASS_ArenaBlock *prev = block->prev;
+        ass_aligned_free(block);
+        block = prev;
+    }
+    arena->block = NULL;
+    arena->pos = 0;
+    arena->total = 0;
+}
+
 void ass_msg(ASS_Library *priv, int lvl, const char *fmt, ...)
 {
     va_list va;
@@ -90,6 +90,8 @@ static inline bool ass_string_equal(ASS_StringView str1, ASS_StringView str2)
 void *ass_aligned_alloc(size_t alignment, size_t size, bool zero);
 void ass_aligned_free(void *ptr);
 
+int64_t ass_time_ns(void);
+
 void *ass_realloc_array(void *ptr, size_t nmemb, size_t size);
 void *ass_try_realloc_array(void *ptr, size_t nmemb, size_t size);
 
@@ -106,6 +108,30 @@ void *ass_try_realloc_array(void *ptr, size_t nmemb, size_t size);
 #define ASS_REALLOC_ARRAY(ptr, count) \
     (errno = 0, (ptr) = ass_try_realloc_array(ptr, count, sizeof(*ptr)), !errno)
 
+/*
+ * Bump-pointer allocator for short-lived data. Allocations are never
+ * freed individually; ass_arena_reset() releases all of them at once and
+ * merges the blocks grown since the last reset into a single one, so that
+ * a steady workload does not touch the heap at all.
+ * A zero-filled ASS_Arena is empty and valid.
+ */
+typedef struct ass_arena_block ASS_ArenaBlock;
+
+typedef struct {
+    ASS_ArenaBlock *block;  // current block, linked to the earlier ones
+    size_t pos;             // used bytes of the current block
+    size_t total;           // size of all blocks
+} ASS_Arena;
+
+// allocations are aligned to this
+#define ASS_ARENA_ALIGN 16
+
+void *ass_arena_alloc(ASS_Arena *arena, size_t size);
+void *ass_arena_realloc_array(ASS_Arena *arena, void *ptr,
+                              size_t old_nmemb, size_t nmemb, size_t size);
+void ass_arena_reset(ASS_Arena *arena);
+void ass_arena_free(ASS_Arena *arena);
+
 unsigned ass_utf8_get_char(char **str);
 unsigned ass_utf8_put_char(char *dest, uint32_t ch);
 void ass_utf16be_to_utf8(char *dst, size_t dst_size, uint8_t *src, size_t src_size);
@@ -88,3 +88,122 @@ void ass_mul_bitmaps_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
         src2 += src2_stride;
     }
 }
+
+// x / 255 rounded to nearest, for x <= 65535 * 255,
+// which covers the products of 16-bit samples as well
+static inline unsigned div255(unsigned x)
+{
+    return (x + 127) / 255;
+}
+
+/**
+ * \brief Blend a bitmap in a solid color onto premultiplied RGBA pixels
+ * Standard "over" compositing with coverage src * (255 - color alpha).
+ */
+void ass_blend_rgba_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                      const uint8_t *restrict src, ptrdiff_t src_stride,
+                      size_t width, size_t height, uint32_t color)
+{
+    ASSUME(width > 0 && height > 0);
+
+    unsigned r = color >> 24;
+    unsigned g = (color >> 16) & 0xFF;
+    unsigned b = (color >> 8) & 0xFF;
+    unsigned a = 255 - (color & 0xFF);
+
+    uint8_t *end = dst + dst_stride * height;
+    while (dst < end) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * a);
+            unsigned inv = 255 - k;
+            uint8_t *px = dst + 4 * x;
+            px[0] = div255(r * k + px[0] * inv);
+            px[1] = div255(g * k + px[1] * inv);
+            px[2] = div255(b * k + px[2] * inv);
+            px[3] = div255(255 * k + px[3] * inv);
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+/**
+ * \brief Blend a bitmap in a solid color onto a plane of 8-bit samples
+ */
+void ass_blend_plane8_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                        const uint8_t *restrict src, ptrdiff_t src_stride,
+                        size_t width, size_t height,
+                        uint32_t value, unsigned alpha, unsigned shift)
+{
+    ASSUME(width > 0 && height > 0);
+
+    uint8_t *end = dst + dst_stride * height;
+    while (dst < end) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            dst[x] = div255(value * k + dst[x] * (255 - k));
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ass_blend_uv8_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                     const uint8_t *restrict src, ptrdiff_t src_stride,
+                     size_t width, size_t height,
+                     uint32_t value, unsigned alpha, unsigned shift)
+{
+    ASSUME(width > 0 && height > 0);
+
+    unsigned u = value & 0xFFFF, v = value >> 16;
+    uint8_t *end = dst + dst_stride * height;
+    while (dst < end) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            dst[2 * x]     = div255(u * k + dst[2 * x]     * (255 - k));
+            dst[2 * x + 1] = div255(v * k + dst[2 * x + 1] * (255 - k));
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ass_blend_plane16_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                         const uint8_t *restrict src, ptrdiff_t src_stride,
+                         size_t width, size_t height,
+                         uint32_t value, unsigned alpha, unsigned shift)
+{
+    ASSUME(width > 0 && height > 0);
+
+    uint8_t *end = dst + dst_stride * height;
+    while (dst < end) {
+        uint16_t *row = (uint16_t *) dst;
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            row[x] = div255(value * k + (row[x] >> shift) * (255 - k)) << shift;
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ass_blend_uv16_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                      const uint8_t *restrict src, ptrdiff_t src_stride,
+                      size_t width, size_t height,
+                      uint32_t value, unsigned alpha, unsigned shift)
+{
+    ASSUME(width > 0 && height > 0);
+
+    unsigned u = value & 0xFFFF, v = value >> 16;
+    uint8_t *end = dst + dst_stride * height;
+    while (dst < end) {
+        uint16_t *row = (uint16_t *) dst;
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            row[2 * x]     = div255(u * k + (row[2 * x]     >> shift) * (255 - k)) << shift;
+            row[2 * x + 1] = div255(v * k + (row[2 * x + 1] >> shift) * (255 - k)) << shift;
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
@@ -21,6 +21,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 #include "../libass/ass.h"
 
 typedef struct image_s {
@@ -40,7 +45,21 @@ void msg_callback(int level, const char *fmt, va_list va, void *data)
     printf("\n");
 }
 
-static void init(int frame_w, int frame_h)
+static double time_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return 1000.0 * t.QuadPart / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000.0 * ts.tv_sec + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static void init_library(void)
 {
     ass_library = ass_library_init();
     if (!ass_library) {
@@ -50,7 +69,10 @@ static void init(int frame_w, int frame_h)
 
     ass_set_message_cb(ass_library, msg_callback, NULL);
     ass_set_extract_fonts(ass_library, 1);
+}
 
+static void init_renderer(int frame_w, int frame_h)
+{
     ass_renderer = ass_renderer_init(ass_library);
     if (!ass_renderer) {
         printf("ass_renderer_init failed!\n");
@@ -68,30 +90,58 @@ int main(int argc, char *argv[])
     const int frame_h = 720;
 
     if (argc < 5) {
-        printf("usage: %s <subtitle file> <start time> <fps> <end time>\n",
-               argv[0] ? argv[0] : "profile");
+        printf("usage: %s <subtitle file> <start time> <fps> <end time> "
+               "[load repeats]\n", argv[0] ? argv[0] : "profile");
         exit(1);
     }
     char *subfile = argv[1];
     double tm = strtod(argv[2], 0);
     double fps = strtod(argv[3], 0);
     double end_time = strtod(argv[4], 0);
+    int repeats = argc > 5 ? atoi(argv[5]) : 1;
 
     if (fps == 0) {
         printf("fps cannot equal 0\n");
         exit(1);
     }
-
-    init(frame_w, frame_h);
-    ASS_Track *track = ass_read_file(ass_library, subfile, NULL);
-    if (!track) {
-        printf("track init failed!\n");
+    if (repeats < 1) {
+        printf("load repeats must be at least 1\n");
         exit(1);
     }
 
+    init_library();
+
+    // Parsing, including decoding of embedded fonts, can be benchmarked
+    // on its own by loading the file several times and rendering nothing.
+    ASS_Track *track = NULL;
+    double load_start = time_ms();
+    for (int i = 0; i < repeats; i++) {
+        if (track) {
+            ass_free_track(track);
+            ass_clear_fonts(ass_library);
+        }
+        track = ass_read_file(ass_library, subfile, NULL);
+        if (!track) {
+            printf("track init failed!\n");
+            exit(1);
+        }
+    }
+    double load_time = (time_ms() - load_start) / repeats;
+    printf("load: %.3f ms per file\n", load_time);
+
+    init_renderer(frame_w, frame_h);
+
+    int frames = 0;
+    double render_start = time_ms();
     while (tm < end_time) {
         ass_render_frame(ass_renderer, track, (int) (tm * 1000), NULL);
         tm += 1 / fps;
+        frames++;
+    }
+    if (frames) {
+        double render_time = time_ms() - render_start;
+        printf("render: %d frames in %.3f ms, %.3f ms per frame\n",
+               frames, render_time, render_time / frames);
     }
 
     ass_free_track(track);
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the blending of bitmaps into 8 and 16-bit YUV samples
+ * with the exactly rounded blend of each sample.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_bitmap_engine.h"
+
+#define WIDTH  37
+#define HEIGHT 5
+#define SRC_STRIDE 41  // any stride, as with ASS_Image bitmaps
+#define DST_STRIDE (4 * WIDTH + 10)
+
+static int failures;
+
+// x / 255 rounded to nearest; x / 255 is never halfway between integers
+static unsigned round255(unsigned x)
+{
+    return (x + 127) / 255;
+}
+
+static unsigned get_sample(const uint8_t *p, int size)
+{
+    if (size == 1)
+        return *p;
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void set_sample(uint8_t *p, int size, unsigned value)
+{
+    if (size == 1) {
+        *p = value;
+        return;
+    }
+    uint16_t v = value;
+    memcpy(p, &v, sizeof(v));
+}
+
+/**
+ * \param n_comp 1 for a plane, 2 for interleaved chroma
+ * \param size bytes per sample
+ */
+static void check_blend(BlendYUVFunc *func, const char *name,
+                        int n_comp, int size, int depth, unsigned shift)
+{
+    static uint8_t src[SRC_STRIDE * HEIGHT];
+    static uint8_t dst[DST_STRIDE * HEIGHT], orig[DST_STRIDE * HEIGHT];
+    uint32_t mask = (1u << depth) - 1;
+
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < sizeof(src); i++)
+            src[i] = rand();
+        // make full and zero coverage common
+        src[rand() % sizeof(src)] = 0;
+        src[rand() % sizeof(src)] = 255;
+        for (int i = 0; i < sizeof(orig); i += size)
+            set_sample(orig + i, size, (rand() & mask) << shift);
+        memcpy(dst, orig, sizeof(dst));
+
+        // planes take the sample value, interleaved chroma U | V << 16
+        unsigned comp[2] = { rand() & mask, rand() & mask };
+        uint32_t value = n_comp == 1 ? comp[0] : comp[0] | comp[1] << 16;
+        unsigned alpha = round % 5 ? rand() & 0xFF : 255;
+        int w = 1 + rand() % WIDTH;
+        // the destination does not need to be aligned
+        func(dst + size, DST_STRIDE, src, SRC_STRIDE, w, HEIGHT,
+             value, alpha, shift);
+
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < DST_STRIDE; x += size) {
+                int pos = y * DST_STRIDE + x;
+                unsigned old = get_sample(orig + pos, size);
+                unsigned new = get_sample(dst + pos, size);
+                unsigned expected = old;
+                int px = (x - size) / size;
+                if (x >= size && px < n_comp * w) {
+                    unsigned k = round255(src[y * SRC_STRIDE + px / n_comp] * alpha);
+                    unsigned c = comp[px % n_comp];
+                    expected = round255(c * k + (old >> shift) * (255 - k)) << shift;
+                }
+                if (new != expected) {
+                    printf("%s_%u: sample %d, %d is %u instead of %u\n",
+                           name, shift, x, y, new, expected);
+                    failures++;
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    BitmapEngine engine = ass_bitmap_engine_init(ASS_CPU_FLAG_ALL);
+    srand(1);
+    check_blend(engine.blend_plane8, "blend_plane8", 1, 1, 8, 0);
+    check_blend(engine.blend_uv8, "blend_uv8", 2, 1, 8, 0);
+    check_blend(engine.blend_plane16, "blend_plane16", 1, 2, 10, 0);
+    check_blend(engine.blend_plane16, "blend_plane16", 1, 2, 10, 6);
+    check_blend(engine.blend_plane16, "blend_plane16", 1, 2, 16, 0);
+    check_blend(engine.blend_uv16, "blend_uv16", 2, 2, 10, 0);
+    check_blend(engine.blend_uv16, "blend_uv16", 2, 2, 10, 6);
+    check_blend(engine.blend_uv16, "blend_uv16", 2, 2, 16, 0);
+
+    if (failures)
+        return 1;
+    printf("blend yuv: all tests passed\n");
+    return 0;
+}
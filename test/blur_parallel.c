@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the gaussian blur of bitmaps large enough to be spread
+ * over a thread pool with the blur on a single thread.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_bitmap.h"
+#include "ass_bitmap_engine.h"
+#include "ass_bitmap_pool.h"
+#include "ass_threading.h"
+
+static int failures;
+
+static bool same_bitmap(const Bitmap *a, const Bitmap *b)
+{
+    if (a->left != b->left || a->top != b->top ||
+            a->w != b->w || a->h != b->h || a->stride != b->stride)
+        return false;
+    for (int32_t y = 0; y < a->h; y++)
+        if (memcmp(a->buffer + y * a->stride, b->buffer + y * b->stride, a->w))
+            return false;
+    return true;
+}
+
+static void check_blur(const BitmapEngine *engine, ASS_ThreadPool *pool,
+                       int32_t w, int32_t h, double r2x, double r2y,
+                       const char *name)
+{
+    Bitmap ref, new;
+    if (!ass_alloc_bitmap(engine, &ref, w, h, true)) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+    ref.left = 10;
+    ref.top = -20;
+    // blocks of random levels, so that the blur has edges to smooth
+    for (int32_t y = 0; y < h; y++)
+        for (int32_t x = 0; x < w; x++)
+            ref.buffer[y * ref.stride + x] = ((x / 7) * 31 + (y / 5) * 17) % 13 ?
+                0 : rand() % 256;
+    if (!ass_copy_bitmap(engine, &new, &ref)) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+
+    bool ok_ref = ass_gaussian_blur(engine, NULL, &ref, r2x, r2y);
+    bool ok_new = ass_gaussian_blur(engine, pool, &new, r2x, r2y);
+    if (!ok_ref || !ok_new || !same_bitmap(&ref, &new)) {
+        printf("%s: parallel blur of %dx%d differs (r2 %g, %g)\n",
+               name, w, h, r2x, r2y);
+        failures++;
+    }
+    ass_free_bitmap(&ref);
+    ass_free_bitmap(&new);
+}
+
+static void test_engine(unsigned flags, const char *name)
+{
+    BitmapEngine engine = ass_bitmap_engine_init(flags);
+    engine.pool = ass_bitmap_pool_create(1 << engine.align_order, 0);
+    if (!engine.pool) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+
+    // all sizes are above the area from which the blur runs in parallel
+    static const int32_t sizes[][2] = {
+        { 256, 256 }, { 300, 301 }, { 1000, 70 }, { 70, 1000 }, { 777, 555 },
+    };
+    static const double radii[][2] = {
+        { 0.5, 0.5 }, { 4, 4 }, { 30, 2 }, { 1, 150 }, { 400, 400 },
+    };
+    static const int n_threads[] = { 2, 5, 16 };
+    for (int i = 0; i < sizeof(n_threads) / sizeof(*n_threads); i++) {
+        ASS_ThreadPool *pool = ass_thread_pool_create(n_threads[i]);
+        if (!pool)
+            break;  // no threading support
+        srand(i);
+        for (int j = 0; j < sizeof(sizes) / sizeof(*sizes); j++)
+            for (int k = 0; k < sizeof(radii) / sizeof(*radii); k++)
+                check_blur(&engine, pool, sizes[j][0], sizes[j][1],
+                           radii[k][0], radii[k][1], name);
+        ass_thread_pool_free(pool);
+    }
+
+    ass_bitmap_pool_free(engine.pool);
+}
+
+int main(void)
+{
+    test_engine(ASS_CPU_FLAG_ALL, "default");
+    test_engine(ASS_CPU_FLAG_NONE, "c");
+    test_engine(ASS_CPU_FLAG_NONE | ASS_FLAG_WIDE_STRIPE, "c wide");
+
+    if (failures)
+        return 1;
+    printf("blur parallel: all tests passed\n");
+    return 0;
+}
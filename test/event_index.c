@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the time index lookup of ass_find_active_events()
+ * with a linear scan of the events.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ass.h"
+#include "ass_priv.h"
+
+static int failures;
+
+static void msg_callback(int level, const char *fmt, va_list va, void *data)
+{
+}
+
+static void add_event(ASS_Track *track, long long start, long long duration)
+{
+    int eid = ass_alloc_event(track);
+    if (eid < 0) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+    track->events[eid].Start = start;
+    track->events[eid].Duration = duration;
+    // as the parser does, so that ass_prune_events() looks at the event
+    ASS_ParserPriv *priv = track->parser_priv;
+    if (start + duration < priv->prune_next_ts)
+        priv->prune_next_ts = start + duration;
+}
+
+static void check_time(ASS_Track *track, const char *name, long long now)
+{
+    int *active;
+    int n = ass_find_active_events(track, now, &active);
+
+    int k = 0;
+    for (int i = 0; i < track->n_events; i++) {
+        ASS_Event *event = track->events + i;
+        if (event->Start > now || now >= event->Start + event->Duration)
+            continue;
+        if (k >= n || active[k] != i)
+            break;
+        k++;
+    }
+    if (k == n) {
+        int expected = 0;
+        for (int i = 0; i < track->n_events; i++) {
+            ASS_Event *event = track->events + i;
+            expected += event->Start <= now && now < event->Start + event->Duration;
+        }
+        if (expected == n)
+            return;
+    }
+    printf("%s: wrong events at %lld\n", name, now);
+    failures++;
+}
+
+static void check_range(ASS_Track *track, const char *name,
+                        long long from, long long to)
+{
+    for (long long now = from; now <= to; now++)
+        check_time(track, name, now);
+}
+
+static void test_overlapping(ASS_Library *library)
+{
+    ASS_Track *track = ass_new_track(library);
+    add_event(track, 0, 1000);
+    add_event(track, 100, 50);
+    add_event(track, 100, 300);
+    add_event(track, 120, 10);
+    add_event(track, 500, 2000);
+    add_event(track, 990, 20);
+    check_range(track, "overlapping", -10, 2600);
+    ass_free_track(track);
+}
+
+static void test_zero_length(ASS_Library *library)
+{
+    ASS_Track *track = ass_new_track(library);
+    add_event(track, 10, 0);
+    add_event(track, 10, 5);
+    add_event(track, 12, 0);
+    add_event(track, 15, -5);
+    add_event(track, 15, 1);
+    check_range(track, "zero-length", 0, 30);
+    ass_free_track(track);
+}
+
+static void test_reordered(ASS_Library *library)
+{
+    ASS_Track *track = ass_new_track(library);
+    srand(1);
+    for (int i = 0; i < 200; i++)
+        add_event(track, rand() % 5000, rand() % 300);
+    check_range(track, "reordered", -10, 5400);
+
+    // appended events are merged into the existing index
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 10; i++)
+            add_event(track, rand() % 5000, rand() % 300);
+        for (int i = 0; i < 50; i++)
+            check_time(track, "reordered append", rand() % 5400);
+    }
+
+    // pruned entries are removed from the index instead of rebuilding it,
+    // events appended since the last lookup are still merged in later
+    int n_indexed = track->n_events;
+    for (int i = 0; i < 10; i++)
+        add_event(track, rand() % 5000, rand() % 300);
+    ass_prune_events(track, 2500);
+    if (track->n_events == n_indexed + 10 ||
+            !track->parser_priv->event_index_count) {
+        printf("reordered prune: index not kept\n");
+        failures++;
+    }
+    check_range(track, "reordered prune", -10, 5400);
+    for (int i = 0; i < 30; i++)
+        add_event(track, rand() % 5000, rand() % 300);
+    check_range(track, "reordered prune", -10, 5400);
+
+    ass_flush_events(track);
+    check_time(track, "reordered flush", 2600);
+    for (int i = 0; i < 30; i++)
+        add_event(track, rand() % 5000, rand() % 300);
+    check_range(track, "reordered flush", -10, 5400);
+    ass_free_track(track);
+}
+
+static void test_edited(ASS_Library *library)
+{
+    ASS_Track *track = ass_new_track(library);
+    srand(2);
+    for (int i = 0; i < 100; i++)
+        add_event(track, rand() % 5000, rand() % 300);
+    check_range(track, "edited", 0, 5400);
+
+    for (int round = 0; round < 20; round++) {
+        ASS_Event *event = track->events + rand() % track->n_events;
+        event->Start = rand() % 5000;
+        event->Duration = rand() % 300;
+        ass_track_invalidate(track);
+        for (int i = 0; i < 50; i++)
+            check_time(track, "edited", rand() % 5400);
+    }
+
+    // edits of events near the looked up time are noticed without it
+    add_event(track, 8000, 100);
+    check_time(track, "edited", 8050);
+    ASS_Event *event = track->events + track->n_events - 1;
+    event->Duration = 10;
+    check_range(track, "edited", 7990, 8120);
+    event->Start = 8060;
+    check_range(track, "edited", 7990, 8120);
+    ass_free_track(track);
+}
+
+int main(void)
+{
+    ASS_Library *library = ass_library_init();
+    if (!library) {
+        printf("ass_library_init failed!\n");
+        return 1;
+    }
+    ass_set_message_cb(library, msg_callback, NULL);
+
+    test_overlapping(library);
+    test_zero_length(library);
+    test_reordered(library);
+    test_edited(library);
+
+    ass_library_done(library);
+    if (failures)
+        return 1;
+    printf("event index: all tests passed\n");
+    return 0;
+}
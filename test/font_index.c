@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Writes a font index, reads it back, and checks that stale,
+ * truncated and corrupt indexes are rejected.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+#include "ass.h"
+#include "ass_fontindex.h"
+
+#define INDEX_FILE  "test_font_index.tmp"
+#define DEP_FILE    "test_font_index.dep"
+#define DEP_MISSING "test_font_index.missing"
+#define TAG 1234
+
+// offsets into the header, see ass_fontindex.c
+#define HEADER_VERSION 8
+#define HEADER_SIZE    16
+#define HEADER_N_DEPS  20
+#define HEADER_N_FONTS 24
+#define HEADER_FONTS   28
+
+static int failures;
+
+static const char *deps[] = { DEP_FILE, DEP_MISSING };
+
+static char *families[][2] = {
+    { "Test Sans", "Test Sans Localized" },
+    { "Test Serif" },
+    { "Test Mono" },
+};
+static char *fullnames[][1] = {
+    { "Test Sans Bold" },
+    { "Test Serif Italic" },
+    { NULL },
+};
+static const struct {
+    int n_family, n_fullname;
+    char *postscript_name;
+    int weight;
+    long style_flags;
+    const char *path;
+    int index;
+    uint32_t chars[3];
+} fonts[] = {
+    { 2, 1, "TestSans-Bold", 700, 0, "/fonts/sans.ttc", 3, { 'A', 0x4E00, 0x1F600 } },
+    { 1, 1, NULL, 400, 1, "/fonts/serif.ttf", 0, { 'a', 0x3B1, 0x20AC } },
+    { 1, 0, "TestMono", 400, 0, "/fonts/mono.otf", 0, { ' ', 0x1E9E, 0xFFFD } },
+};
+#define N_FONTS (sizeof(fonts) / sizeof(*fonts))
+
+static void msg_callback(int level, const char *fmt, va_list va, void *data)
+{
+}
+
+static void fail(const char *msg)
+{
+    printf("%s\n", msg);
+    failures++;
+}
+
+static bool write_bytes(const char *filename, const char *data, size_t size)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(data, 1, size, fp) == size;
+    return !fclose(fp) && ok;
+}
+
+static char *read_bytes(const char *filename, size_t *size)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return NULL;
+    char *data = NULL;
+    long len;
+    if (!fseek(fp, 0, SEEK_END) && (len = ftell(fp)) > 0 &&
+            !fseek(fp, 0, SEEK_SET) && (data = malloc(len)) &&
+            fread(data, 1, len, fp) != (size_t) len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = data ? len : 0;
+    return data;
+}
+
+static void write_index(ASS_Library *library)
+{
+    ASS_FontIndexWriter *writer = ass_font_index_writer_new(TAG, deps, 2);
+    if (!writer) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < N_FONTS; i++) {
+        // one page per character, in ascending order of pages
+        uint32_t pages[3][FONT_COVERAGE_PAGE_WORDS] = {{0}};
+        for (int j = 0; j < 3; j++) {
+            uint32_t code = fonts[i].chars[j];
+            pages[j][0] = code & ~0xFF;
+            pages[j][1 + (code & 0xFF) / 32] = 1u << (code % 32);
+        }
+        ASS_FontProviderMetaData meta = {
+            .families = families[i],
+            .fullnames = fullnames[i],
+            .n_family = fonts[i].n_family,
+            .n_fullname = fonts[i].n_fullname,
+            .postscript_name = fonts[i].postscript_name,
+            .weight = fonts[i].weight,
+            .style_flags = fonts[i].style_flags,
+        };
+        if (!ass_font_index_writer_add_font(writer, &meta, fonts[i].path,
+                                            fonts[i].index, pages[0], 3)) {
+            printf("allocation failed\n");
+            exit(1);
+        }
+    }
+    if (!ass_font_index_writer_save(writer, library, INDEX_FILE)) {
+        printf("failed to write %s\n", INDEX_FILE);
+        exit(1);
+    }
+    ass_font_index_writer_free(writer);
+}
+
+static bool same_string(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp(a, b));
+}
+
+static void check_contents(ASS_FontIndex *index)
+{
+    if (ass_font_index_size(index) != N_FONTS) {
+        fail("wrong number of fonts");
+        return;
+    }
+    char *names[8];
+    if (ass_font_index_names(index) != 6) {
+        fail("wrong number of names");
+        return;
+    }
+    for (size_t i = 0; i < N_FONTS; i++) {
+        ASS_FontIndexFont font;
+        if (!ass_font_index_get_font(index, i, &font, names)) {
+            fail("font record rejected");
+            continue;
+        }
+        const ASS_FontProviderMetaData *meta = &font.meta;
+        bool ok = meta->n_family == fonts[i].n_family &&
+            meta->n_fullname == fonts[i].n_fullname &&
+            meta->families == names &&
+            meta->fullnames == names + meta->n_family &&
+            same_string(meta->postscript_name, fonts[i].postscript_name) &&
+            meta->weight == fonts[i].weight &&
+            meta->style_flags == fonts[i].style_flags &&
+            same_string(font.path, fonts[i].path) &&
+            font.index == fonts[i].index;
+        for (int j = 0; ok && j < meta->n_family; j++)
+            ok = same_string(meta->families[j], families[i][j]);
+        for (int j = 0; ok && j < meta->n_fullname; j++)
+            ok = same_string(meta->fullnames[j], fullnames[i][j]);
+        for (int j = 0; ok && j < 3; j++) {
+            uint32_t code = fonts[i].chars[j];
+            ok = ass_font_coverage_has_char(&font.coverage, code) &&
+                !ass_font_coverage_has_char(&font.coverage, code ^ 1);
+        }
+        if (!ok)
+            fail("font record read back differs");
+    }
+}
+
+static void test_roundtrip(ASS_Library *library)
+{
+    write_index(library);
+    ASS_FontIndex *index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2);
+    if (!index) {
+        fail("written index rejected");
+        return;
+    }
+    check_contents(index);
+    ass_font_index_close(index);
+
+    // dependencies the caller does not know about are still checked
+    index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 1);
+    if (!index)
+        fail("index rejected with a prefix of its dependencies");
+    ass_font_index_close(index);
+}
+
+static void test_stale(ASS_Library *library)
+{
+    static const char *other_deps[] = { DEP_MISSING, DEP_FILE };
+    ASS_FontIndex *index;
+    if ((index = ass_font_index_open(library, INDEX_FILE, TAG + 1, deps, 2)))
+        fail("index accepted with a different tag");
+    ass_font_index_close(index);
+    if ((index = ass_font_index_open(library, INDEX_FILE, TAG, other_deps, 2)))
+        fail("index accepted with different dependencies");
+    ass_font_index_close(index);
+
+#if defined(HAVE_STRUCT_STAT_ST_MTIM) && !defined(_WIN32)
+    // only the fraction of a second changes
+    write_index(library);
+    struct stat st;
+    if (stat(DEP_FILE, &st)) {
+        printf("failed to stat %s\n", DEP_FILE);
+        exit(1);
+    }
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    times[1].tv_nsec = (times[1].tv_nsec + 500000000) % 1000000000;
+    if (!utimensat(AT_FDCWD, DEP_FILE, times, 0)) {
+        if ((index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2)))
+            fail("index accepted after a sub-second modification");
+        ass_font_index_close(index);
+    }
+#endif
+
+    write_index(library);
+    if (!write_bytes(DEP_MISSING, "", 0)) {
+        printf("failed to write %s\n", DEP_MISSING);
+        exit(1);
+    }
+    if ((index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2)))
+        fail("index accepted after a missing dependency appeared");
+    ass_font_index_close(index);
+    remove(DEP_MISSING);
+}
+
+// reading whatever a damaged index yields must stay within the file
+static bool read_all(ASS_FontIndex *index)
+{
+    size_t n_names = ass_font_index_names(index);
+    char **names = malloc((n_names + 1) * sizeof(char *));
+    if (!names) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+    size_t n_valid = 0, len = 0;
+    for (size_t i = 0; i < ass_font_index_size(index); i++) {
+        ASS_FontIndexFont font;
+        if (!ass_font_index_get_font(index, i, &font, names))
+            continue;
+        n_valid++;
+        for (int j = 0; j < font.meta.n_family + font.meta.n_fullname; j++)
+            len += strlen(names[j]);
+        len += strlen(font.path);
+        if (font.meta.postscript_name)
+            len += strlen(font.meta.postscript_name);
+        for (uint32_t code = 0; code < 0x20000; code += 97)
+            len += ass_font_coverage_has_char(&font.coverage, code);
+    }
+    free(names);
+    return n_valid == N_FONTS && len;
+}
+
+static void set_word(char *data, size_t offset, uint32_t value)
+{
+    memcpy(data + offset, &value, sizeof(value));
+}
+
+static void test_damaged(ASS_Library *library)
+{
+    write_index(library);
+    size_t size;
+    char *good = read_bytes(INDEX_FILE, &size);
+    char *bad = malloc(size);
+    if (!good || !bad) {
+        printf("failed to read %s\n", INDEX_FILE);
+        exit(1);
+    }
+
+    ASS_FontIndex *index;
+    for (size_t len = 0; len < size; len++) {
+        if (!write_bytes(INDEX_FILE, good, len)) {
+            printf("failed to write %s\n", INDEX_FILE);
+            exit(1);
+        }
+        if ((index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2))) {
+            printf("index truncated to %zu bytes accepted\n", len);
+            failures++;
+        }
+        ass_font_index_close(index);
+    }
+
+    static const struct {
+        size_t offset;
+        uint32_t value;
+    } header_damage[] = {
+        { 0, 0x12345678 },
+        { HEADER_VERSION, 0 },
+        { HEADER_SIZE, 0 },
+        { HEADER_N_DEPS, 0xFFFFFFFF },
+        { HEADER_N_FONTS, 0x10000000 },
+        { HEADER_FONTS, 0xFFFFFFF0 },
+        { HEADER_FONTS, 2 },
+    };
+    for (size_t i = 0; i < sizeof(header_damage) / sizeof(*header_damage); i++) {
+        memcpy(bad, good, size);
+        set_word(bad, header_damage[i].offset, header_damage[i].value);
+        if (!write_bytes(INDEX_FILE, bad, size)) {
+            printf("failed to write %s\n", INDEX_FILE);
+            exit(1);
+        }
+        if ((index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2))) {
+            printf("index with damaged header at %zu accepted\n",
+                   header_damage[i].offset);
+            failures++;
+        }
+        ass_font_index_close(index);
+    }
+
+    // the records and data can be damaged in any way;
+    // what is accepted must not be read out of bounds
+    int n_rejected = 0;
+    for (size_t pos = 0; pos < size; pos++) {
+        memcpy(bad, good, size);
+        bad[pos] ^= 0xA5;
+        if (!write_bytes(INDEX_FILE, bad, size)) {
+            printf("failed to write %s\n", INDEX_FILE);
+            exit(1);
+        }
+        index = ass_font_index_open(library, INDEX_FILE, TAG, deps, 2);
+        n_rejected += !index || !read_all(index);
+        ass_font_index_close(index);
+    }
+    if (!n_rejected)
+        fail("no damaged index rejected");
+
+    free(good);
+    free(bad);
+}
+
+int main(void)
+{
+    ASS_Library *library = ass_library_init();
+    if (!library) {
+        printf("ass_library_init failed!\n");
+        return 1;
+    }
+    ass_set_message_cb(library, msg_callback, NULL);
+
+    remove(DEP_MISSING);
+    if (!write_bytes(DEP_FILE, "", 0)) {
+        printf("failed to write %s\n", DEP_FILE);
+        return 1;
+    }
+
+    test_roundtrip(library);
+    test_stale(library);
+    test_damaged(library);
+
+    remove(INDEX_FILE);
+    remove(DEP_FILE);
+    ass_library_done(library);
+    if (failures)
+        return 1;
+    printf("font index: all tests passed\n");
+    return 0;
+}
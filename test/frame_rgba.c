@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the output of ass_render_frame_rgba() with blending the images
+ * of ass_render_frame(), on background boxes and merged images, whose
+ * bitmaps have unaligned strides.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass.h"
+
+#define FRAME_W 331
+#define FRAME_H 211
+#define STRIDE  (4 * FRAME_W + 12)
+
+// BackColour &H00FF8000 as ASS_Image color 0xRRGGBBAA
+#define BOX_COLOR 0x0080FF00
+
+static char script[] =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "PlayResX: 331\n"
+    "PlayResY: 211\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+    "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, "
+    "ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, "
+    "Alignment, MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Box,Arial,20,&HFF000000,&HFF000000,&HFF000000,&H00FF8000,"
+    "0,0,0,0,100,100,0,0,4,0,3,7,0,0,0,1\n"
+    "Style: Plain,Arial,20,&H400000FF,&H000000FF,&H00000000,&H00000000,"
+    "0,0,0,0,100,100,0,0,1,0,0,7,0,0,0,1\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+    "Effect, Text\n"
+    "Dialogue: 0,0:00:00.00,0:00:05.00,Box,,0,0,0,,"
+    "{\\pos(13,17)\\p1}m 0 0 l 37 0 37 23 0 23\n"
+    // the inverse clip splits the drawing into touching parts to merge
+    "Dialogue: 1,0:00:00.00,0:00:05.00,Plain,,0,0,0,,"
+    "{\\pos(101,97)\\iclip(130,0,133,211)\\p1}m 0 0 l 77 0 77 41 0 41\n";
+
+static int failures;
+
+static void msg_callback(int level, const char *fmt, va_list va, void *data)
+{
+}
+
+// x / 255 rounded to nearest
+static unsigned div255(unsigned x)
+{
+    return (x + 127) / 255;
+}
+
+static void blend_image(uint8_t *buf, const ASS_Image *img)
+{
+    unsigned color[4] = {
+        img->color >> 24, (img->color >> 16) & 0xFF, (img->color >> 8) & 0xFF, 255,
+    };
+    unsigned alpha = 255 - (img->color & 0xFF);
+    for (int y = 0; y < img->h; y++) {
+        const uint8_t *src = img->bitmap + y * img->stride;
+        uint8_t *dst = buf + (img->dst_y + y) * STRIDE + 4 * img->dst_x;
+        for (int x = 0; x < img->w; x++) {
+            unsigned k = div255(src[x] * alpha);
+            for (int c = 0; c < 4; c++)
+                dst[4 * x + c] = div255(color[c] * k + dst[4 * x + c] * (255 - k));
+        }
+    }
+}
+
+static void check_frame(ASS_Renderer *renderer, ASS_Track *track,
+                        const char *name)
+{
+    static uint8_t buf[STRIDE * FRAME_H], ref[STRIDE * FRAME_H];
+    memset(buf, 0x5A, sizeof(buf));
+    if (!ass_render_frame_rgba(renderer, track, 1000, buf, STRIDE, NULL)) {
+        printf("%s: ass_render_frame_rgba failed\n", name);
+        failures++;
+        return;
+    }
+
+    memset(ref, 0, sizeof(ref));
+    const ASS_Image *box = NULL;
+    bool unaligned = false;
+    for (const ASS_Image *img = ass_render_frame(renderer, track, 1000, NULL);
+            img; img = img->next) {
+        blend_image(ref, img);
+        unaligned |= img->stride % 16 != 0;
+        if (img->color == BOX_COLOR)
+            box = img;
+    }
+    if (!box || !unaligned) {
+        printf("%s: no background box or unaligned image rendered\n", name);
+        failures++;
+        return;
+    }
+
+    for (int y = 0; y < FRAME_H; y++) {
+        if (memcmp(buf + y * STRIDE, ref + y * STRIDE, 4 * FRAME_W)) {
+            printf("%s: composited frame differs in row %d\n", name, y);
+            failures++;
+            return;
+        }
+    }
+
+    // the box is opaque, and the other event is drawn away from it
+    static const uint8_t box_px[4] = { 0x00, 0x80, 0xFF, 0xFF };
+    for (int y = box->dst_y; y < box->dst_y + box->h; y++) {
+        for (int x = box->dst_x; x < box->dst_x + box->w; x++) {
+            if (memcmp(buf + y * STRIDE + 4 * x, box_px, 4)) {
+                printf("%s: wrong background box pixel at %d, %d\n", name, x, y);
+                failures++;
+                return;
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    ASS_Library *library = ass_library_init();
+    if (!library) {
+        printf("ass_library_init failed!\n");
+        return 1;
+    }
+    ass_set_message_cb(library, msg_callback, NULL);
+
+    ASS_Renderer *renderer = ass_renderer_init(library);
+    ASS_Track *track = ass_read_memory(library, script, sizeof(script) - 1, NULL);
+    if (!renderer || !track) {
+        printf("initialization failed!\n");
+        return 1;
+    }
+    ass_set_storage_size(renderer, FRAME_W, FRAME_H);
+    ass_set_frame_size(renderer, FRAME_W, FRAME_H);
+    ass_set_fonts(renderer, NULL, NULL, ASS_FONTPROVIDER_NONE, NULL, 0);
+
+    check_frame(renderer, track, "separate");
+    ass_set_image_merging(renderer, 1);
+    check_frame(renderer, track, "merged");
+
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    ass_library_done(library);
+    if (failures)
+        return 1;
+    printf("frame rgba: all tests passed\n");
+    return 0;
+}
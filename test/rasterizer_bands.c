@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the banded rasterization of ass_rasterizer_fill_bands()
+ * with ass_rasterizer_fill() on large outlines.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_bitmap_engine.h"
+#include "ass_outline.h"
+#include "ass_rasterizer.h"
+#include "ass_threading.h"
+#include "ass_utils.h"
+
+static int failures;
+
+static int32_t rnd_range(int32_t min, int32_t max)
+{
+    return min + rand() % (max - min + 1);
+}
+
+// overlapping contours of random curves around the center of a w x h window
+static bool generate_outline(ASS_Outline *outline, int w, int h)
+{
+    outline->n_points = outline->n_segments = 0;
+    for (int contour = 0; contour < 6; contour++) {
+        int32_t cx = 64 * rnd_range(w / 4, 3 * w / 4);
+        int32_t cy = 64 * rnd_range(h / 4, 3 * h / 4);
+        int n = rnd_range(3, 40);
+        for (int i = 0; i < n; i++) {
+            char segment = rnd_range(OUTLINE_LINE_SEGMENT, OUTLINE_CUBIC_SPLINE);
+            for (int j = 0; j < segment; j++) {
+                ASS_Vector pt = {
+                    cx + 64 * rnd_range(-w / 2, w / 2) + rnd_range(0, 63),
+                    cy + 64 * rnd_range(-h / 2, h / 2) + rnd_range(0, 63),
+                };
+                if (!ass_outline_add_point(outline, pt, j ? 0 : segment))
+                    return false;
+            }
+        }
+        ass_outline_close_contour(outline);
+    }
+    return true;
+}
+
+static bool rasterize(const BitmapEngine *engine, RasterizerData *rst,
+                      RasterizerData *const *scratch, ASS_ThreadPool *pool,
+                      const ASS_Outline *outline, uint8_t **buf,
+                      int *w, int *h, ptrdiff_t *stride)
+{
+    if (!ass_rasterizer_set_outline(rst, outline, false))
+        return false;
+
+    // same window as ass_outline_to_bitmap()
+    int32_t x_min = (rst->bbox.x_min -   1) >> 6;
+    int32_t y_min = (rst->bbox.y_min -   1) >> 6;
+    int32_t x_max = (rst->bbox.x_max + 127) >> 6;
+    int32_t y_max = (rst->bbox.y_max + 127) >> 6;
+    int mask = (1 << engine->tile_order) - 1;
+    *w = (x_max - x_min + mask) & ~mask;
+    *h = (y_max - y_min + mask) & ~mask;
+    *stride = ass_align(1 << engine->align_order, *w);
+    *buf = ass_aligned_alloc(1 << engine->align_order, *stride * *h, false);
+    if (!*buf)
+        return false;
+
+    if (pool)
+        return ass_rasterizer_fill_bands(engine, rst, scratch, pool, *buf,
+                                         x_min, y_min, *w, *h, *stride);
+    return ass_rasterizer_fill(engine, rst, *buf, x_min, y_min, *w, *h, *stride);
+}
+
+static void check_outline(const BitmapEngine *engine, RasterizerData *rst,
+                          RasterizerData *const *scratch, ASS_ThreadPool *pool,
+                          const ASS_Outline *outline, const char *name)
+{
+    uint8_t *ref = NULL, *new = NULL;
+    int ref_w, ref_h, new_w, new_h;
+    ptrdiff_t ref_stride, new_stride;
+    bool ok =
+        rasterize(engine, rst, scratch, NULL, outline,
+                  &ref, &ref_w, &ref_h, &ref_stride) &&
+        rasterize(engine, rst, scratch, pool, outline,
+                  &new, &new_w, &new_h, &new_stride);
+    if (!ok || ref_w != new_w || ref_h != new_h ||
+            memcmp(ref, new, ref_stride * ref_h)) {
+        printf("%s: banded rasterization differs\n", name);
+        failures++;
+    }
+    ass_aligned_free(ref);
+    ass_aligned_free(new);
+}
+
+static void test_engine(unsigned flags, const char *name)
+{
+    BitmapEngine engine = ass_bitmap_engine_init(flags);
+    RasterizerData rst, scratch_data[8];
+    RasterizerData *scratch[8];
+    ASS_Outline outline;
+    if (!ass_rasterizer_init(&engine, &rst, 16) ||
+            !ass_outline_alloc(&outline, 64, 64)) {
+        printf("allocation failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < 8; i++) {
+        scratch[i] = &scratch_data[i];
+        if (!ass_rasterizer_init(&engine, scratch[i], 16)) {
+            printf("allocation failed\n");
+            exit(1);
+        }
+    }
+
+    static const int n_threads[] = { 2, 3, 8 };
+    for (int i = 0; i < sizeof(n_threads) / sizeof(*n_threads); i++) {
+        ASS_ThreadPool *pool = ass_thread_pool_create(n_threads[i]);
+        if (!pool)
+            break;  // no threading support
+        srand(i);
+        for (int j = 0; j < 10; j++) {
+            if (!generate_outline(&outline, 1500, 1000)) {
+                printf("allocation failed\n");
+                exit(1);
+            }
+            check_outline(&engine, &rst, scratch, pool, &outline, name);
+        }
+        ass_thread_pool_free(pool);
+    }
+
+    for (int i = 0; i < 8; i++)
+        ass_rasterizer_done(scratch[i]);
+    ass_rasterizer_done(&rst);
+    ass_outline_free(&outline);
+}
+
+int main(void)
+{
+    test_engine(ASS_CPU_FLAG_ALL, "small tiles");
+    test_engine(ASS_CPU_FLAG_ALL | ASS_FLAG_LARGE_TILES, "large tiles");
+
+    if (failures)
+        return 1;
+    printf("rasterizer bands: all tests passed\n");
+    return 0;
+}